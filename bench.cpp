@@ -0,0 +1,404 @@
+/**
+ * @file bench.cpp
+ * @brief Throughput benchmark for the JSONpp parser, writer and lookups.
+ *
+ * Build: g++ bench.cpp -o bench.out -O2 -std=c++11 -pthread
+ * Run:   ./bench.out [iterations]   (from the repository root)
+ *
+ * Every document is parsed (from memory, by several threads, by a reused handler,
+ * from the file, in chunks, as events and lazily for the lookups; documents that
+ * are arrays also as JSON Lines, one element per line), printed through operator<<
+ * and json::dump and queried through let::operator[] many times. Results are
+ * reported as MB/s, ns per value and heap allocations per document (counted by
+ * replacing the global operator new).
+ */
+
+#include "src/JSONpp.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <memory>
+#include <new>
+#include <sstream>
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+// The replacements below pair malloc and free; inlined into the library GCC
+// sees a new expression released by free and warns
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static std::uint64_t allocations = 0; // Number of calls to the global operator new
+
+void* operator new(size_t n)
+{
+	allocations++;
+	if (void* p = std::malloc(n ? n : 1))
+		return p;
+	throw std::bad_alloc();
+}
+void* operator new[](size_t n) { return operator new(n); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+std::chrono::steady_clock::time_point hClock()
+{
+	return std::chrono::steady_clock::now();
+}
+
+std::uint64_t TimeDuration(std::chrono::steady_clock::time_point Time)
+{
+	return (std::chrono::steady_clock::now() - Time) / std::chrono::nanoseconds(1);
+}
+
+/** countValues()
+ * @brief Counts the JSON values of a document (scalars and containers, not keys)
+ * without using the library, so ns/value stays comparable across parser changes
+ * @param buffer NUL terminated JSON text
+ * @return Number of values found
+ */
+static size_t countValues(const char* buffer)
+{
+	size_t count = 0;
+	bool inString = false;
+	char last = ' '; // Last structural character outside of strings
+	for (const char* c = buffer; *c; ++c)
+	{
+		if (inString)
+		{
+			if (*c == '\\')
+				++c;
+			else if (*c == '"')
+				inString = false;
+			continue;
+		}
+		switch (*c)
+		{
+		case '"':
+		{
+			// A string is a value unless it is followed by ':'
+			const char* e = c + 1;
+			while (*e && *e != '"')
+				e += *e == '\\' ? 2 : 1;
+			const char* n = *e ? e + 1 : e;
+			while (*n == ' ' || *n == '\t' || *n == '\r' || *n == '\n')
+				++n;
+			if (*n != ':')
+				count++;
+			inString = true;
+			break;
+		}
+		case '{':
+		case '[':
+			count++;
+			last = *c;
+			break;
+		case '}':
+		case ']':
+		case ',':
+		case ':':
+			last = *c;
+			break;
+		case ' ':
+		case '\t':
+		case '\r':
+		case '\n':
+			break;
+		default:
+			// First character of a number or literal
+			if (last == ',' || last == '[' || last == ':' || last == ' ')
+				count++;
+			last = 'v';
+			break;
+		}
+	}
+	return count;
+}
+
+// Handler of JSON::parseEvents that counts the values of a document
+struct Counter : json::EventHandler
+{
+	size_t count = 0;
+	bool onObjectStart() { return ++count, true; }
+	bool onArrayStart() { return ++count, true; }
+	bool onString(const char*, size_t) { return ++count, true; }
+	bool onNumber(long long) { return ++count, true; }
+	bool onNumber(double) { return ++count, true; }
+	bool onBool(bool) { return ++count, true; }
+	bool onNull() { return ++count, true; }
+};
+
+struct Result
+{
+	double seconds = 0;		   // Total time spent
+	std::uint64_t allocs = 0;  // Total allocations
+	size_t bytes = 0;		   // Bytes processed per iteration
+	size_t values = 0;		   // Values processed per iteration
+	int iterations = 0;		   // Times the operation was repeated
+};
+
+static void report(const char* file, const char* operation, const Result& r)
+{
+	double mbs = r.seconds > 0 ? (double)r.bytes * r.iterations / r.seconds / (1024.0 * 1024.0) : 0;
+	double nsValue = r.values ? r.seconds * 1e9 / ((double)r.values * r.iterations) : 0;
+	double allocs = r.iterations ? (double)r.allocs / r.iterations : 0;
+	std::cout << std::left << std::setw(14) << file << std::setw(14) << operation << std::right
+			  << std::fixed << std::setprecision(1) << std::setw(12) << mbs
+			  << std::setw(12) << nsValue << std::setw(14) << allocs << std::endl;
+}
+
+/** lookup()
+ * @brief Follows a path of object keys and array positions through let::operator[]
+ * @param path Keys, numeric keys are array positions when the node is an array
+ * @return Number of steps resolved
+ */
+static size_t lookup(json::let& root, const std::vector<const char*>& path)
+{
+	json::let* node = &root;
+	size_t steps = 0;
+	for (auto key : path)
+	{
+		if (node->getType() == json::Type::Object)
+			node = &(*node)[key];
+		else if (node->getType() == json::Type::Array && (size_t)atoi(key) < node->size())
+			node = &(*node)[atoi(key)];
+		else
+			break;
+		steps++;
+	}
+	return steps;
+}
+
+static void bench(const char* path, const char* name, int iterations,
+				  const std::vector<std::vector<const char*>>& queries)
+{
+	long int size = 0;
+	char* file = readFile(path, &size);
+	if (!file)
+	{
+		std::cout << std::left << std::setw(14) << name << "cannot open " << path << std::endl;
+		return;
+	}
+	std::string source(file, (size_t)size);
+	delete[] file;
+	size_t values = countValues(source.c_str());
+
+	// Parse: every run gets a fresh copy of the text made off the clock. JSON::Parse
+	// releases it, except in situ where the tree points into it and the bench keeps it
+	json::let* root = nullptr; // Tree of the last parse, it lives in the handler
+	std::unique_ptr<json::JSON> handler; // The tree keys live in the handler that parsed it
+	std::unique_ptr<char[]> kept;		 // Buffer of the last in situ parse
+	auto parse = [&](unsigned flags) {
+		Result r;
+		r.bytes = source.size(), r.values = values, r.iterations = iterations;
+		for (int i = 0; i < iterations; i++)
+		{
+			char* buffer = new char[source.size() + 1];
+			memcpy(buffer, source.c_str(), source.size() + 1);
+			handler.reset(new json::JSON);
+			std::uint64_t before = allocations;
+			auto start = hClock();
+			root = &handler->Parse(buffer, flags);
+			r.seconds += TimeDuration(start) * 1e-9;
+			r.allocs += allocations - before;
+			if (flags & json::parseInSitu)
+				kept.reset(buffer);
+		}
+		return r;
+	};
+	// Stage 1 alone: structural index of the text, with the classifier picked at run time
+	std::vector<unsigned> index;
+	auto scan = [&](bool utf8) {
+		Result r;
+		r.bytes = source.size(), r.values = values, r.iterations = iterations;
+		size_t invalid = 0;
+		for (int i = 0; i < iterations; i++)
+		{
+			std::uint64_t before = allocations;
+			auto start = hClock();
+			json::buildStructuralIndex(source.c_str(), source.size(), index, utf8 ? &invalid : nullptr);
+			r.seconds += TimeDuration(start) * 1e-9;
+			r.allocs += allocations - before;
+		}
+		return r;
+	};
+	report(name, "stage 1", scan(false));
+	report(name, "stage 1 utf8", scan(true));
+	report(name, "parse", parse(json::parseDefault));
+	report(name, "parse insitu", parse(json::parseInSitu));
+	report(name, "parse parallel", parse(json::parseParallel));
+
+	// One handler parsing the text again and again through JSON::parseText, which
+	// borrows the text and reuses the containers of the previous tree
+	Result reused;
+	reused.bytes = source.size(), reused.values = values, reused.iterations = iterations;
+	json::JSON reader;
+	for (int warm = 0; warm < 2; warm++) // The arenas settle on their block size
+		reader.parseText(source.c_str());
+	for (int i = 0; i < iterations; i++)
+	{
+		std::uint64_t before = allocations;
+		auto start = hClock();
+		reader.parseText(source.c_str());
+		reused.seconds += TimeDuration(start) * 1e-9;
+		reused.allocs += allocations - before;
+	}
+	report(name, "parse reuse", reused);
+
+	// Parse straight from the file through JSON::parseFile, mapping included
+	Result mapped;
+	mapped.bytes = source.size(), mapped.values = values, mapped.iterations = iterations;
+	for (int i = 0; i < iterations; i++)
+	{
+		handler.reset(new json::JSON);
+		std::uint64_t before = allocations;
+		auto start = hClock();
+		root = &handler->parseFile(path);
+		mapped.seconds += TimeDuration(start) * 1e-9;
+		mapped.allocs += allocations - before;
+	}
+	report(name, "parse file", mapped);
+
+	// Parse through JSON::feed in chunks of 64 KB, as they would come from a socket
+	Result streamed;
+	streamed.bytes = source.size(), streamed.values = values, streamed.iterations = iterations;
+	for (int i = 0; i < iterations; i++)
+	{
+		handler.reset(new json::JSON);
+		std::uint64_t before = allocations;
+		auto start = hClock();
+		for (size_t offset = 0; offset < source.size(); offset += 65536)
+			handler->feed(source.data() + offset, std::min(source.size() - offset, (size_t)65536));
+		root = &handler->finish();
+		streamed.seconds += TimeDuration(start) * 1e-9;
+		streamed.allocs += allocations - before;
+	}
+	report(name, "parse stream", streamed);
+
+	// Events of JSON::parseEvents counted without building a tree
+	Result events;
+	events.bytes = source.size(), events.values = values, events.iterations = iterations;
+	json::JSON scanner;
+	Counter counter;
+	for (int i = 0; i < iterations; i++)
+	{
+		std::uint64_t before = allocations;
+		auto start = hClock();
+		scanner.parseEvents(source.c_str(), counter);
+		events.seconds += TimeDuration(start) * 1e-9;
+		events.allocs += allocations - before;
+	}
+	report(name, "events", events);
+
+	// Lazy parse followed by one run of the lookups, the only values materialized
+	Result lazy;
+	lazy.bytes = source.size(), lazy.values = values, lazy.iterations = iterations;
+	for (int i = 0; i < iterations; i++)
+	{
+		char* buffer = new char[source.size() + 1];
+		memcpy(buffer, source.c_str(), source.size() + 1);
+		std::unique_ptr<json::JSON> owner(new json::JSON); // root keeps its own handler
+		std::uint64_t before = allocations;
+		auto start = hClock();
+		json::let& document = owner->Parse(buffer, json::parseLazy);
+		for (auto& query : queries)
+			lookup(document, query);
+		lazy.seconds += TimeDuration(start) * 1e-9;
+		lazy.allocs += allocations - before;
+	}
+	report(name, "parse lazy", lazy);
+
+	// Elements of an array root as JSON Lines, parsed by json::LineReader
+	if (root->getType() == json::Type::Array)
+	{
+		String lines;
+		for (size_t i = 0; i < root->size(); i++)
+			json::dump((*root)[(int)i], lines, -1), lines += '\n';
+		json::LineReader reader;
+		Result records;
+		records.bytes = lines.size(), records.values = values - 1, records.iterations = iterations;
+		for (int i = 0; i < iterations; i++)
+		{
+			std::uint64_t before = allocations;
+			auto start = hClock();
+			reader.parse(lines.data(), lines.size());
+			records.seconds += TimeDuration(start) * 1e-9;
+			records.allocs += allocations - before;
+		}
+		report(name, "parse lines", records);
+	}
+
+	// Serialization through operator<<
+	Result print;
+	print.values = values, print.iterations = iterations;
+	for (int i = 0; i < iterations; i++)
+	{
+		std::ostringstream os;
+		std::uint64_t before = allocations;
+		auto start = hClock();
+		os << *root;
+		print.seconds += TimeDuration(start) * 1e-9;
+		print.allocs += allocations - before;
+		print.bytes = os.str().size();
+	}
+	report(name, "operator<<", print);
+
+	// Serialization through json::dump into a reused String
+	String out;
+	auto dump = [&](int indent) {
+		Result r;
+		r.values = values, r.iterations = iterations;
+		for (int i = 0; i < iterations; i++)
+		{
+			out.clear();
+			std::uint64_t before = allocations;
+			auto start = hClock();
+			json::dump(*root, out, indent);
+			r.seconds += TimeDuration(start) * 1e-9;
+			r.allocs += allocations - before;
+			r.bytes = out.size();
+		}
+		return r;
+	};
+	report(name, "dump", dump(-1));
+	report(name, "dump pretty", dump(2));
+
+	// Lookups through let::operator[]; values counts resolved steps
+	Result find;
+	find.iterations = iterations;
+	for (int i = 0; i < iterations; i++)
+	{
+		std::uint64_t before = allocations;
+		size_t steps = 0;
+		auto start = hClock();
+		for (int repeat = 0; repeat < 1000; repeat++)
+			for (auto& query : queries)
+				steps += lookup(*root, query);
+		find.seconds += TimeDuration(start) * 1e-9;
+		find.allocs += allocations - before;
+		find.values = steps;
+	}
+	report(name, "operator[]", find);
+}
+
+int main(int argc, char** argv)
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 10;
+	if (iterations <= 0)
+		iterations = 10;
+	std::cout << std::left << std::setw(14) << "file" << std::setw(14) << "operation" << std::right
+			  << std::setw(12) << "MB/s" << std::setw(12) << "ns/value" << std::setw(14) << "allocs/doc"
+			  << std::endl;
+	bench("tests/canada.json", "canada.json", iterations,
+		  { { "type" }, { "features", "0", "geometry", "type" }, { "features", "0", "properties", "name" } });
+	bench("tests/catalog.json", "catalog.json", iterations,
+		  { { "areaNames", "205705993" },
+			{ "events", "138586341", "name" },
+			{ "seatCategoryNames", "338937295" },
+			{ "venueNames", "PLEYEL_PLEYEL" } });
+	bench("tests/test.json", "test.json", iterations,
+		  { { "0", "description" }, { "3", "tests", "1", "valid" }, { "9", "schema", "$ref" } });
+	return 0;
+}
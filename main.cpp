@@ -3,7 +3,7 @@
 //#include <chrono>
 #include <fstream>
 
-void Log(json::let val)
+void Log(const json::let& val)
 {
 	std::cout << val << std::endl;
 }
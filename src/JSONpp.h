@@ -17,6 +17,25 @@
 #include <iostream>
 #include <vector>
 #include <string>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <cstdlib>
+#include <cstdio>
+#include <thread>
+#include "JSONppTables.h"
+#include "JSONppSimd.h"
+#if defined(__unix__) || defined(__APPLE__)
+#define JSON_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
  //#include <sstream>
 
 #if defined(__clang__)
@@ -47,11 +66,13 @@ inline char* readFile(const char* fileName, long int* size = (long int*)0)
 	std::ifstream ifs(fileName, std::ios::in | std::ios::binary | std::ios::ate);
 	if (ifs.good() || ifs.is_open()) {
 		std::ifstream::pos_type fileSize = ifs.tellg();
-		char* fi = new char[fileSize];
+		char* fi = new char[(size_t)fileSize + 1];
 		ifs.seekg(0, ifs.beg);
 		ifs.read(fi, fileSize);
 		ifs.close();
-		*size = (long int)fileSize;
+		fi[(size_t)fileSize] = '\0'; // The parser reads NUL terminated text
+		if (size)
+			*size = (long int)fileSize;
 		return fi;
 	}
 
@@ -75,23 +96,29 @@ String str(T value) { return std::to_string(value); } // Function that stringify
 
 namespace json
 {
-	enum class Type;		   // Enum that determines the value type
+	enum class Type : unsigned char; // Enum that determines the value type
 	enum class jsonOperations; // Infile json possible operation
 	class let;				   // Class that stores a value of "any" type
 	template <typename ID, typename VAL>
 	class Map;
 	class obj;						// Class that acts like a JS object
 	class JSON;						// Json file handler
+	class LineReader;				// Parser of JSON Lines texts
+	class Schema;					// Compiled JSON Schema, see JSONppSchema.h
+	class Query;					// Compiled JSON Pointer or JSONPath query
 	typedef obj Object;				// obj class with easy to remember name
 	typedef std::vector<let> Array; // A std::vector that allocates lets
 	int n_tab = 0;					// Number of tabs used to print on console
 									// Const values used in Json file parsing
 
-	std::ostream& operator<<(std::ostream& os, let& _let); // Operator << to print prettier the let values
+	template <typename Sink>
+	class Writer; // Serializes lets as JSON text
+
+	std::ostream& operator<<(std::ostream& os, const let& _let); // Operator << to print prettier the let values
 	template <typename T>
-	std::ostream& operator<<(std::ostream& os, std::vector<T> arr); // Operator << to print any printable std::vector
-	std::ostream& operator<<(std::ostream& os, obj obj);			// Operator << to correctly print an object
-	enum class Type													// Enum that determines the var type
+	std::ostream& operator<<(std::ostream& os, const std::vector<T>& arr); // Operator << to print any printable std::vector
+	std::ostream& operator<<(std::ostream& os, const obj& obj);			   // Operator << to correctly print an object
+	enum class Type : unsigned char									// Enum that determines the var type
 	{
 		None = 0 << 1,
 		Number = 1 << 1,
@@ -102,6 +129,17 @@ namespace json
 		Array = 6 << 1
 	};
 
+	// Options of JSON::Parse, combined with |
+	enum ParseFlags : unsigned
+	{
+		parseDefault = 0,		   // Strings are copied into the document arena
+		parseInSitu = 1 << 0,	   // Strings are decoded inside the input buffer, which must outlive the tree
+		parseValidateUtf8 = 1 << 1, // The text must be valid UTF-8
+		parseLazy = 1 << 2,			// Only the structural index is built, objects and arrays are parsed on first access
+		parseParallel = 1 << 3,		// Large objects and arrays are split into slices parsed by several threads
+		parseNoIndex = 1 << 4		// The text is parsed character by character, without building the structural index first
+	};
+
 	enum class jsonOperations
 	{
 		none,
@@ -111,8 +149,331 @@ namespace json
 		arrayClose
 	};
 
+	/** hashKey()
+	 * @brief FNV-1a hash of a key
+	 * @param key Characters of the key
+	 * @param len Length of the key
+	 * @return Hash of the key contents
+	 */
+	inline size_t hashKey(const char* key, size_t len)
+	{
+		unsigned long long h = 14695981039346656037ULL;
+		for (size_t i = 0; i < len; ++i)
+			h = (h ^ (unsigned char)key[i]) * 1099511628211ULL;
+		return (size_t)h;
+	}
+
+	/** Arena class
+	 * @brief Bump allocator that owns every block it hands out until it is reset
+	 * or destroyed. Blocks grow geometrically so a document costs a handful of
+	 * allocations, and reset() keeps the largest block for the next document
+	 */
+	class Arena
+	{
+	public:
+		Arena() = default;
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+		Arena(Arena&& other) noexcept { *this = static_cast<Arena&&>(other); }
+		Arena& operator=(Arena&& other) noexcept
+		{
+			if (this != &other)
+			{
+				release();
+				blocks = other.blocks, cursor = other.cursor, end = other.end, nextSize = other.nextSize;
+				other.blocks = nullptr, other.cursor = other.end = nullptr, other.nextSize = minBlock;
+			}
+			return *this;
+		}
+		~Arena() { release(); }
+		/** allocate()
+		 * @brief Reserves memory inside the arena
+		 * @param n Number of bytes
+		 * @param align Alignment of the returned pointer, must be a power of two
+		 * @return Pointer valid until reset() or the arena destruction
+		 */
+		char* allocate(size_t n, size_t align = 1)
+		{
+			char* p = (char*)(((size_t)cursor + align - 1) & ~(align - 1));
+			if (!cursor || p + n > end)
+			{
+				grow(n + align);
+				p = (char*)(((size_t)cursor + align - 1) & ~(align - 1));
+			}
+			cursor = p + n;
+			return p;
+		}
+		/** copy()
+		 * @brief Copies a string into the arena
+		 * @param str Characters to copy
+		 * @param len Number of characters
+		 * @return NUL terminated copy
+		 */
+		const char* copy(const char* str, size_t len)
+		{
+			char* out = allocate(len + 1);
+			memcpy(out, str, len);
+			out[len] = '\0';
+			return out;
+		}
+		// Forgets every allocation, keeping the most recent (and largest) block
+		void reset()
+		{
+			if (!blocks)
+				return;
+			Block* keep = blocks;
+			blocks = keep->next;
+			release();
+			blocks = keep, keep->next = nullptr;
+			cursor = (char*)(keep + 1), end = cursor + keep->size;
+		}
+
+	private:
+		struct Block
+		{
+			Block* next; // Previously allocated block
+			size_t size; // Usable bytes after the header
+		};
+		static const size_t minBlock = 4096, maxBlock = 1 << 20;
+		void grow(size_t n)
+		{
+			size_t size = nextSize > n ? nextSize : n;
+			Block* block = (Block*)new char[sizeof(Block) + size];
+			block->next = blocks, block->size = size;
+			blocks = block;
+			cursor = (char*)(block + 1), end = cursor + size;
+			if (nextSize < maxBlock)
+				nextSize <<= 1;
+		}
+		void release()
+		{
+			while (blocks)
+			{
+				Block* next = blocks->next;
+				delete[] (char*)blocks;
+				blocks = next;
+			}
+			cursor = end = nullptr;
+		}
+		Block* blocks = nullptr;   // Most recent block first
+		char* cursor = nullptr;	   // Next free byte of the current block
+		char* end = nullptr;	   // End of the current block
+		size_t nextSize = minBlock; // Size of the next block
+	};
+
+	/** MappedFile class
+	 * @brief Whole file in memory followed by a NUL character. On POSIX systems
+	 * the file is mapped from the page cache with private copy on write pages,
+	 * so it can be parsed in situ without touching the file; one zero page is
+	 * mapped after it when the file ends on a page boundary. Elsewhere the file
+	 * is read into a buffer
+	 */
+	class MappedFile
+	{
+	public:
+		MappedFile() = default;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		~MappedFile() { close(); }
+		/** open()
+		 * @brief Loads a file, releasing the previous one
+		 * @param path Path to the file
+		 * @return false if the file cannot be read
+		 */
+		bool open(const char* path);
+		// Releases the file
+		void close();
+		// Characters of the file, followed by a NUL
+		char* data() const { return text; }
+		// Number of characters of the file
+		size_t size() const { return length; }
+
+	private:
+		char* text = nullptr;
+		size_t length = 0; // Size of the file
+		size_t mapped = 0; // Size of the mapping, 0 if text was allocated with new[]
+	};
+
+	inline bool MappedFile::open(const char* path)
+	{
+		close();
+#ifdef JSON_MMAP
+		int fd = ::open(path, O_RDONLY);
+		struct stat info;
+		if (fd < 0 || fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+		{
+			if (fd >= 0)
+				::close(fd);
+			return false;
+		}
+		// An anonymous mapping one page longer than the file is reserved first and
+		// the file is placed over it, so the byte after the file is always zero
+		size_t page = (size_t)sysconf(_SC_PAGESIZE);
+		length = (size_t)info.st_size;
+		mapped = (length / page + 1) * page;
+		void* base = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANON, -1, 0);
+		if (base == MAP_FAILED)
+		{
+			::close(fd);
+			mapped = length = 0;
+			return false;
+		}
+		if (length)
+		{
+			int options = MAP_PRIVATE | MAP_FIXED;
+#ifdef MAP_POPULATE
+			options |= MAP_POPULATE; // Fault the pages in ahead of the parser
+#endif
+			if (mmap(base, length, PROT_READ | PROT_WRITE, options, fd, 0) == MAP_FAILED)
+			{
+				munmap(base, mapped);
+				::close(fd);
+				mapped = length = 0;
+				return false;
+			}
+#ifdef MADV_SEQUENTIAL
+			madvise(base, length, MADV_SEQUENTIAL);
+#endif
+		}
+		::close(fd);
+		text = (char*)base;
+		return true;
+#else
+		long int fileSize = 0;
+		text = readFile(path, &fileSize);
+		length = text ? (size_t)fileSize : 0;
+		return text != nullptr;
+#endif
+	}
+
+	inline void MappedFile::close()
+	{
+#ifdef JSON_MMAP
+		if (mapped)
+			munmap(text, mapped);
+#endif
+		if (!mapped)
+			delete[] text;
+		text = nullptr, length = mapped = 0;
+	}
+
+	/** Key struct
+	 * @brief Characters and length of an object key. Keys may hold NUL
+	 * characters (\u0000), so they are compared and written by length.
+	 * NUL terminated strings convert to keys and keys to them
+	 */
+	struct Key
+	{
+		Key() = default;
+		Key(const char* key) : str(key), len(key ? strlen(key) : 0) {}
+		Key(const char* key, size_t length) : str(key), len(length) {}
+		operator const char*() const { return str; }
+		const char* str = nullptr; // Characters, followed by a NUL
+		size_t len = 0;			   // Number of characters
+	};
+
+	/** KeyTable class
+	 * @brief Interns object keys: every distinct key is copied once into the
+	 * table arena and every later occurrence gets the same pointer, so interned
+	 * keys can be compared by address
+	 */
+	class KeyTable
+	{
+	public:
+		KeyTable() = default;
+		/** intern()
+		 * @brief Finds or stores a key
+		 * @param key Characters of the key
+		 * @param len Length of the key
+		 * @return Key owned by the table
+		 */
+		Key intern(const char* key, size_t len);
+		Key intern(const Key& key) { return intern(key.str, key.len); }
+		// Forgets every key, keeping the arena memory for reuse
+		void clear()
+		{
+			slots.assign(slots.size(), Slot());
+			count = 0;
+			arena.reset();
+		}
+		// Number of distinct keys stored
+		size_t Size() const { return count; }
+
+	private:
+		struct Slot
+		{
+			const char* key = nullptr; // Interned key, nullptr marks a free slot
+			size_t len = 0;			   // Length of the key
+			size_t hash = 0;		   // Hash of the key
+		};
+		void rehash();
+		std::vector<Slot> slots; // Open addressing table, size is a power of two
+		size_t count = 0;		 // Used slots
+		Arena arena;			 // Storage of the key characters
+	};
+
+	inline Key KeyTable::intern(const char* key, size_t len)
+	{
+		if (2 * (count + 1) > slots.size())
+			rehash();
+		size_t hash = hashKey(key, len), mask = slots.size() - 1, i = hash & mask;
+		while (slots[i].key)
+		{
+			if (slots[i].hash == hash && slots[i].len == len && memcmp(slots[i].key, key, len) == 0)
+				return Key(slots[i].key, len);
+			i = (i + 1) & mask;
+		}
+		slots[i].key = arena.copy(key, len), slots[i].len = len, slots[i].hash = hash;
+		count++;
+		return Key(slots[i].key, len);
+	}
+
+	inline void KeyTable::rehash()
+	{
+		std::vector<Slot> old(slots.empty() ? 64 : 2 * slots.size());
+		old.swap(slots);
+		size_t mask = slots.size() - 1;
+		for (auto& slot : old)
+			if (slot.key)
+			{
+				size_t i = slot.hash & mask;
+				while (slots[i].key)
+					i = (i + 1) & mask;
+				slots[i] = slot;
+			}
+	}
+
+	/** MapKey struct
+	 * @brief Hash and equality used by Map for its identifiers, specialize it to
+	 * change how a type of identifier is compared
+	 * @tparam ID type of identifier
+	 */
+	template <typename ID>
+	struct MapKey
+	{
+		static size_t hash(const ID& id) { return std::hash<ID>()(id); }
+		static Bool equal(const ID& a, const ID& b) { return a == b; }
+	};
+	// Keys are compared by contents, interned keys by address first
+	template <>
+	struct MapKey<const char*>
+	{
+		static size_t hash(const char* id) { return hashKey(id, strlen(id)); }
+		static Bool equal(const char* a, const char* b) { return a == b || strcmp(a, b) == 0; }
+	};
+	// Object keys are compared by length and contents, interned keys by address first
+	template <>
+	struct MapKey<Key>
+	{
+		static size_t hash(const Key& id) { return hashKey(id.str, id.len); }
+		static Bool equal(const Key& a, const Key& b) { return a.len == b.len && (a.str == b.str || memcmp(a.str, b.str, a.len) == 0); }
+	};
+
 	/** Map class
-	 * @brief Class replacement of std::map due to allocation issues
+	 * @brief Class replacement of std::map due to allocation issues.
+	 * Values are kept in insertion order; once the map grows past indexThreshold
+	 * entries a hash index over the identifiers is built on the first lookup and
+	 * kept in sync by insert() and pop_back()
 	 * @tparam ID type to identify the stored value, usually std::string or const char*
 	 * @tparam VAL type of value stored, can be any supported by std::vector allocator
 	 */
@@ -121,11 +482,8 @@ namespace json
 	{
 	public:
 		Map() = default;
-		~Map()
-		{
-			values.~vector();
-			ids.~vector();
-		}
+		// Number of entries from which lookups use the hash index instead of a linear scan
+		static const size_t indexThreshold = 16;
 		// Returns the length of the map
 		size_t Size() const { return values.size(); }
 		/** insert()
@@ -133,30 +491,61 @@ namespace json
 		 * @param _id ID type identifier variable
 		 * @param _value VAL type value variable
 		 */
-		void insert(const ID& _id, const VAL& _value) { ids.push_back(_id), values.push_back(_value); }
+		void insert(const ID& _id, const VAL& _value) { ids.push_back(_id), values.push_back(_value), indexLast(); }
+		// Same as insert(), moving the value in
+		void insert(const ID& _id, VAL&& _value) { ids.push_back(_id), values.push_back(std::move(_value)), indexLast(); }
+		/** emplace()
+		 * @brief Inserts a value built in place at the end of the map
+		 * @param _id ID type identifier variable
+		 * @param args Arguments of a VAL constructor
+		 * @return Reference to the stored value
+		 */
+		template <typename... Args>
+		VAL& emplace(const ID& _id, Args&&... args)
+		{
+			ids.push_back(_id), values.emplace_back(std::forward<Args>(args)...), indexLast();
+			return values.back();
+		}
 		/** insert()
 		 * @brief Inserts value at the end of the map
 		 * @param tp pair of type <ID, VAL> that contains the values
 		 */
-		void insert(std::pair<ID, VAL>& tp) { ids.push_back(tp.first), values.push_back(tp.second); }
+		void insert(std::pair<ID, VAL>& tp) { ids.push_back(tp.first), values.push_back(tp.second), indexLast(); }
+		// Allocates room for a number of entries, later inserts do not move the stored ones
+		void reserve(size_t count) { ids.reserve(count), values.reserve(count); }
 		// Removes the last value on map
-		void pop_back() { ids.pop_back(), values.pop_back(); }
-		VAL& operator[](ID& idx);
+		void pop_back() { unindexLast(), ids.pop_back(), values.pop_back(); }
+		VAL& operator[](const ID& idx);
 		VAL& operator[](size_t idx) { return values.at(idx); }
+		const VAL& operator[](size_t idx) const { return values.at(idx); }
 		/** getId()
 		 * @brief Get the id of actual value
 		 * @param idx Index of searching value
 		 * @return Identifier found
 		 */
 		ID getId(size_t& idx) const { return ids[idx]; }
+		// Replaces the identifier of an entry by an equal one, stored elsewhere
+		void setId(size_t idx, const ID& id) { ids[idx] = id; }
 		/** find()
 		 * @brief Finds value by index position
 		 * @param idx  Index of searching id
 		 * @return Index of found id
 		 */
-		size_t find(ID& idx) const;
+		size_t find(const ID& idx) const;
+		/** find()
+		 * @brief Finds value by an id whose hash is already known
+		 * @param id Identifier to search
+		 * @param hash MapKey<ID>::hash() of the id
+		 * @return Index of found id, -1 if it is not stored
+		 */
+		size_t find(const ID& id, size_t hash) const
+		{
+			size_t i = lookup(id, hash);
+			return i < ids.size() ? i : -1;
+		}
 		/** hasValue()
-		 * @brief Check if map stores specific value
+		 * @brief Check if map stores specific value. Values are not indexed, so
+		 * this is always a linear scan
 		 * @param val Value to find out
 		 * @return true if finds the value
 		 */
@@ -169,10 +558,31 @@ namespace json
 		Bool hasId(const ID& Id) const;
 		// Returns true if map is empty
 		Bool isEmpty() const { return values.empty(); }
+		// Removes every entry, keeping the memory of the map
+		void clear() { ids.clear(), values.clear(), index.clear(); }
 
 	private:
-		std::vector<VAL> values; // Standart vector that stores the values
-		std::vector<ID> ids;	 // Standart vector that stores the identifiers
+		/** lookup()
+		 * @brief Position of the first entry with the given id
+		 * @param id Identifier to search
+		 * @return Position of the entry or Size() if it is not stored
+		 */
+		size_t lookup(const ID& id) const { return lookup(id, ids.size() <= indexThreshold ? 0 : MapKey<ID>::hash(id)); }
+		// Same as lookup(id), hash is only used by maps with an index
+		size_t lookup(const ID& id, size_t hash) const;
+		// Slot of the index where the probe sequence of a hash starts
+		size_t slotOf(size_t hash) const
+		{
+			unsigned long long h = hash;
+			h ^= h >> 33, h *= 0xff51afd7ed558ccdULL, h ^= h >> 33;
+			return (size_t)h & (index.size() - 1);
+		}
+		void buildIndex() const;
+		void indexLast();
+		void unindexLast();
+		std::vector<VAL> values;			   // Standart vector that stores the values
+		std::vector<ID> ids;				   // Standart vector that stores the identifiers
+		mutable std::vector<unsigned> index; // Open addressing table of positions + 1, 0 marks a free slot
 	};
 
 	/** obj class
@@ -184,31 +594,78 @@ namespace json
 	{
 	public:
 		obj() = default;
-		~obj() noexcept { values.~Map(); }
-		let& operator[](const char* name) { return values.operator[](name); }
+		// Copies own their keys, they do not depend on the obj or document they come from
+		obj(const obj& other);
+		obj(obj&& other) noexcept = default;
+		obj& operator=(const obj& other);
+		obj& operator=(obj&& other) noexcept = default;
+		/** operator[]
+		 * @brief Finds a value by its key contents, adding a null value if the key
+		 * is not stored. New keys are copied into the obj
+		 * @param name Key of the value
+		 * @return Reference to the stored value
+		 */
+		let& operator[](const char* name);
+		/** emplace()
+		 * @brief Sets the value of a key, building it in place from a value of an
+		 * admitted type. Rvalue lets, arrays and objects are moved, not copied.
+		 * New keys are copied into the obj
+		 * @param name Key of the value
+		 * @param value Value to be stored
+		 * @return Reference to the stored value
+		 */
+		template <typename T>
+		let& emplace(const char* name, T&& value);
 		// Returns true if obj is empty
 		Bool isEmpty() { return values.isEmpty(); }
-		friend std::ostream& operator<<(std::ostream& os, obj obj);
+		friend std::ostream& operator<<(std::ostream& os, const obj& obj);
+		friend class JSON;
+		friend class let;
+		friend class Schema;
+		friend class Query;
+		template <typename Sink>
+		friend class Writer;
 
 	private:
 		/** addValue()
-		 * @brief Adds value to obj variable
-		 * @tparam T Any of admitted let types
-		 * @param name Identifier of the new value
+		 * @brief Sets the value of a key, adding it if it is not stored
+		 * @param name Identifier of the value, owned by the obj or interned in a
+		 * KeyTable that outlives it
 		 * @param val Value to be stored
+		 * @return Reference to the stored value
 		 */
-		template <typename T>
-		void addValue(String name, T val)
+		let& addValue(const Key& name, const let& val);
+		// Same as addValue(), moving the value in
+		let& addValue(const Key& name, let&& val);
+		/** addMember()
+		 * @brief Adds a member read from a document. A key repeated in a document
+		 * keeps its first value, as lookups find it
+		 * @param name Identifier of the value, interned in a KeyTable that outlives the obj
+		 * @return Empty value to fill, nullptr if the key is stored
+		 */
+		let* addMember(const Key& name)
 		{
-			values.insert(name, val);
+			return values.find(name) == (size_t)-1 ? &values.emplace(name) : nullptr;
 		}
 		/** getId()
 		 * @brief Get the Id of stored value
 		 * @param val Index position of stored value
 		 * @return Identifier value: String
 		 */
-		String getId(size_t val) const { return values.getId(val); }
-		Map<const char*, let> values; // Map that stores the objects values
+		String getId(size_t val) const
+		{
+			Key key = values.getId(val);
+			return String(key.str, key.len);
+		}
+		/** ownKey()
+		 * @brief Copies a key into the obj
+		 * @param key Characters of the key
+		 * @param len Length of the key
+		 * @return Key owned by the obj
+		 */
+		Key ownKey(const char* key, size_t len);
+		Map<Key, let> values; // Map that stores the objects values
+		std::vector<std::unique_ptr<char[]>> keys; // Keys owned by the obj: inserted by user code, or copied
 									   //String parent;			 // Parent identifier
 	};
 
@@ -223,65 +680,181 @@ namespace json
 			type = Type::None;
 			_null = null;
 		}
+		let(const let& other) { assign(other); }
+		// Moves leave the other let empty, containers and owned strings change hands.
+		// Lazy values are materialized first, moved ones do not read the index later
+		let(let&& other) noexcept { other.detach(), take(other); }
 		~let() { clear(); }
-		template <typename T>
-		let(T value) { operator=(value); }
+		// Values of the admitted types, rvalue arrays and objects are moved in
+		template <typename T, typename = typename std::enable_if<!std::is_same<typename std::decay<T>::type, let>::value>::type>
+		let(T&& value) { setValue(std::forward<T>(value)); }
 		// Conversion function
 		template <typename T>
 		operator T()
 		{
 			return getValue<T>();
 		}
-		template <typename T>
-		let& operator=(T value) { return setValue(&value); }
-		template <typename T>
-		let& operator=(T* value) { return setValue(value); }
+		let& operator=(const let& other)
+		{
+			// Copied first, other may be a member of this value
+			if (this != &other)
+			{
+				let copy(other);
+				clear(), take(copy);
+			}
+			return *this;
+		}
+		let& operator=(let&& other) noexcept
+		{
+			if (this != &other)
+			{
+				let moved(std::move(other));
+				clear(), take(moved);
+			}
+			return *this;
+		}
+		template <typename T, typename = typename std::enable_if<!std::is_same<typename std::decay<T>::type, let>::value>::type>
+		let& operator=(T&& value)
+		{
+			let built(std::forward<T>(value));
+			return clear(), take(built), *this;
+		}
 		let& operator[](const std::string& name) { return getObject()[name.c_str()]; }
 		let& operator[](const char* name) { return getObject()[name]; }
-		let& operator[](int idx) { return _array[idx]; }
-		friend std::ostream& operator<<(std::ostream& os, let& _let);
+		/** operator[]
+		 * @brief Finds an element by its position, turning the let into an empty
+		 * array if it holds something else and adding null elements up to the
+		 * position if the array is shorter. Negative positions count from the end
+		 * @param i Position of the element
+		 * @return Reference to the stored element
+		 */
+		let& operator[](int i)
+		{
+			Array& items = getArray();
+			size_t position = i >= 0 ? (size_t)i : (size_t)-i <= items.size() ? items.size() - (size_t)-i : 0;
+			if (position >= items.size())
+				items.resize(position + 1, nullptr);
+			return items[position];
+		}
+		friend std::ostream& operator<<(std::ostream& os, const let& _let);
+		friend class JSON;
+		friend class LineReader;
+		friend class Schema;
+		friend class Query;
+		template <typename Sink>
+		friend class Writer;
 		/** index()
 		 * @brief Get actual value type
 		 * @return Index of actual value type
 		 */
-		short int index() const { return idx; }
+		short int index() const { return materialize(), idx; }
 		/** getType()
 		 * @brief Get the value type
 		 * @return Type of actual value
 		 */
 		Type getType() const { return type; }
+		/** size()
+		 * @brief Get the length of the value
+		 * @return Characters of a string, elements of an array, members of an object, 0 otherwise
+		 */
+		size_t size() const;
 
 	protected:
-		// Unnamed union that stores basic types:
+		// Unnamed union that stores the value, containers are held out of line
 		union
 		{
-			Null _null;			 // Null value storage
-			Bool _bool;			 // Bool value storage
-			int _int;			 // Num value storage
-			float _float;		 // Num value storage
-			long double _double; // Num value storage
-			const char* _str;	 // String value storage
+			Null _null;		  // Null value storage
+			Bool _bool;		  // Bool value storage
+			long long _int;	  // Num value storage
+			float _float;	  // Num value storage
+			double _double;	  // Num value storage
+			const char* _str; // String value storage
+			Array* _array;	  // Array value storage
+			obj* _obj;		  // Object value storage
+			JSON* _lazy;	  // Handler that parsed a lazy object or array
 		};
-		Array _array = {}; // Array value storage
-		obj _obj;		   // Object value storage
+		unsigned int _len = 0; // Length of _str, or structural index entry of a lazy value
 
 	private:
 		void clear(); // Deallocates let values
+		/** materialize()
+		 * @brief Parses the members of a lazy object or array (index 7, see
+		 * parseLazy) in place. Nested objects and arrays stay lazy. The value
+		 * does not change for its users, so this is allowed on const lets, but
+		 * the let and its handler are written: a lazy tree is not safe to read
+		 * from several threads at the same time
+		 */
+		void materialize() const;
+		/** detach()
+		 * @brief Materializes a lazy value and every lazy value under it, so it
+		 * does not read the index of its handler anymore. Only the containers
+		 * built from a lazy document are visited, other trees are left alone
+		 */
+		void detach();
+		/** assign()
+		 * @brief Copies another let into this one, which must be clear. Strings
+		 * are duplicated, borrowed ones (literals, document arenas) too, and
+		 * objects copy their keys, so the copy depends on no handler or buffer.
+		 * Lazy values are materialized first, a copy never reads the index
+		 * @param other let to copy
+		 */
+		void assign(const let& other);
+		/** take()
+		 * @brief Moves another let into this one, which must be clear, leaving
+		 * the other one empty. Nothing is copied
+		 * @param other let to move
+		 */
+		void take(let& other);
+		// Empty type used to pick the getValue() overload of a type at compile time
+		template <typename T>
+		struct tag
+		{
+		};
 		/** getValue()
-		 * @brief Get the actual Value
+		 * @brief Get the actual Value. The overload is chosen at compile time and
+		 * only checks the stored index, a value of another type returns T()
 		 * @tparam T Any of the let admitted types
 		 * @return Actual stored value
 		 */
 		template <typename T>
-		T getValue();
+		T getValue() { return getValue(tag<T>()); }
+		String getValue(tag<String>) { return idx == 0 ? String(_str, _len) : String(); }
+		const char* getValue(tag<const char*>) { return idx == 0 ? _str : nullptr; }
+		Bool getValue(tag<Bool>) { return idx == 1 ? _bool : false; }
+		float getValue(tag<float>) { return (float)getValue(tag<long double>()); }
+		double getValue(tag<double>) { return (double)getValue(tag<long double>()); }
+		long double getValue(tag<long double>)
+		{
+			return idx == 4 ? _double : idx == 2 ? (long double)_int : idx == 3 ? (long double)_float : 0;
+		}
+		template <typename T>
+		typename std::enable_if<std::is_integral<T>::value, T>::type getValue(tag<T>)
+		{
+			return idx == 2 ? (T)_int : idx == 4 ? (T)_double : idx == 3 ? (T)_float : T();
+		}
+		Array getValue(tag<Array>) { return materialize(), idx == 5 ? *_array : Array(); }
+		obj getValue(tag<obj>) { return materialize(), idx == 6 ? *_obj : obj(); }
+		Null getValue(tag<Null>) { return nullptr; }
+		let getValue(tag<let>) { return *this; }
 		/** getObject()
-		 * @brief Get the Object stored
+		 * @brief Get the Object stored, turning the let into an empty object if it
+		 * holds something else
 		 * @return Reference of object stored
 		 */
 		obj& getObject()
 		{
-			idx = 6;
-			return _obj;
+			materialize();
+			if (idx != 6)
+				clear(), _obj = new obj(), idx = 6, type = Type::Object;
+			return *_obj;
+		}
+		// Same as getObject() for arrays
+		Array& getArray()
+		{
+			materialize();
+			if (idx != 5)
+				clear(), _array = new Array(), idx = 5, type = Type::Array;
+			return *_array;
 		}
 		/** setObject()
 		 * @brief Set the Object object
@@ -290,28 +863,69 @@ namespace json
 		 */
 		let& setObject(obj* obj);
 		/** setValue()
-		 * @brief Set a value to the storage
-		 * @tparam T  Type of any of let admitted
+		 * @brief Set a value to the cleared storage. Every admitted type has its
+		 * own overload, so the type is resolved at compile time
 		 * @param value  Value to be stored
 		 * @return Reference to the stored value
 		 */
+		let& setValue(const String& value);
+		let& setValue(const char* value) { return setString(value, strlen(value)); }
+		let& setValue(char* value) { return setValue((const char*)value); }
+		let& setValue(Bool value) { return _bool = value, type = Type::Boolean, idx = 1, *this; }
+		template <typename T>
+		typename std::enable_if<std::is_integral<T>::value, let&>::type setValue(T value)
+		{
+			return _int = (long long)value, type = Type::Number, idx = 2, *this;
+		}
+		let& setValue(float value) { return _float = value, type = Type::Number, idx = 3, *this; }
+		let& setValue(double value) { return _double = value, type = Type::Number, idx = 4, *this; }
+		let& setValue(long double value) { return _double = (double)value, type = Type::Number, idx = 4, *this; }
+		let& setValue(const Array& value) { return _array = new Array(value), type = Type::Array, idx = 5, *this; }
+		let& setValue(Array&& value) { return _array = new Array(std::move(value)), type = Type::Array, idx = 5, *this; }
+		let& setValue(const obj& value) { return _obj = new obj(value), type = Type::Object, idx = 6, *this; }
+		let& setValue(obj&& value) { return _obj = new obj(std::move(value)), type = Type::Object, idx = 6, *this; }
+		let& setValue(Null) { return _null = nullptr, type = Type::Null, idx = -1, *this; }
+		let& setValue(const let& value) { return assign(value), *this; }
+		/** setString()
+		 * @brief Stores a borrowed string of known length
+		 * @param value Characters, NUL terminated, that must outlive the let
+		 * @param len Number of characters
+		 */
+		let& setString(const char* value, size_t len)
+		{
+			return _str = value, _len = (unsigned int)len, type = Type::String, idx = 0, *this;
+		}
+		// Pointers to admitted types store the pointed value, character pointers are strings
 		template <typename T>
-		let& setValue(T* value);
-		short int idx; // Index of actual type
-		Type type;	   // Enum of actual type
+		typename std::enable_if<!std::is_same<T, char>::value, let&>::type setValue(const T* value)
+		{
+			return setValue(*value);
+		}
+		signed char idx = -1;	// Index of actual type
+		Type type = Type::None; // Enum of actual type
+		Bool owned = false;		// True when _str was allocated by this let, or when an object or
+								// array built from a lazy document may hold lazy values
 	};
+	static_assert(sizeof(void*) != 8 || sizeof(let) == 16, "let must stay a 16 bytes tagged value");
 
-	// Typenames accepted by the let class
-	const char* typenames[] = {
-		typeid(String).name(), typeid(String*).name(), typeid(char*).name(),
-		typeid(char).name(), typeid(const char*).name(), typeid(const char).name(),
-		typeid(Bool).name(), typeid(Bool*).name(), typeid(int).name(),
-		typeid(int*).name(), typeid(float).name(), typeid(float*).name(),
-		typeid(long double).name(), typeid(long double*).name(),
-		typeid(double).name(), typeid(double*).name(), typeid(Array).name(),
-		typeid(Array*).name(), typeid(obj).name(), typeid(obj*).name(),
-		typeid(nullptr).name(), typeid(let).name(), typeid(let*).name()
-
+	/** EventHandler struct
+	 * @brief Events of JSON::parseEvents(), in the order of the text. Handlers
+	 * derive from it and hide the events they use; an event that returns false
+	 * stops the parser. Strings are only valid during the call, and hiding one
+	 * onNumber() hides both
+	 */
+	struct EventHandler
+	{
+		bool onObjectStart() { return true; }
+		bool onObjectEnd() { return true; }
+		bool onArrayStart() { return true; }
+		bool onArrayEnd() { return true; }
+		bool onKey(const char*, size_t) { return true; }
+		bool onString(const char*, size_t) { return true; }
+		bool onNumber(long long) { return true; }
+		bool onNumber(double) { return true; }
+		bool onBool(bool) { return true; }
+		bool onNull() { return true; }
 	};
 
 	/** JSON class
@@ -319,7 +933,14 @@ namespace json
 	class JSON
 	{
 	public:
+		friend class let;
+		friend class LineReader;
 		//JSON() = default;
+		/** readJSON()
+		 * @brief Parses a file, keeping its root value in the handler
+		 * @param filename Path to the JSON file
+		 * @return true if the file is valid JSON
+		 */
 		Bool readJSON(String filename);
 		/*let operator[](char* value)
 		{
@@ -327,9 +948,111 @@ namespace json
 			templ = find(value);
 			return &templ[value];
 		}*/
-		let Parse(char* _string = (char*)0);
-		let parseFile(const char* filePath);
-		obj find(String index);
+		/** Parse()
+		 * @brief Parses a JSON buffer. Object keys of the result are interned in
+		 * this handler, so the tree and the values moved out of it are valid until
+		 * the next Parse() or until the handler is destroyed. Copies are not.
+		 * A key repeated in an object keeps its first value.
+		 * With parseInSitu string values are not copied: they are decoded and NUL
+		 * terminated inside the buffer, which then belongs to the caller and must
+		 * outlive the tree.
+		 * The text is indexed first (see JSONppSimd.h) and only the indexed
+		 * positions are visited; texts with comments are read character by character.
+		 * With parseLazy only the index is built: objects and arrays parse their
+		 * members the first time they are accessed, and the handler keeps the
+		 * text until the next parse. Errors of values never visited go unnoticed.
+		 * A copy of a lazy value is parsed whole and a moved one parses its members,
+		 * so values taken out of the tree do not read the index later. Reading a
+		 * lazy tree writes it, so it is read by one thread at a time (a copy can
+		 * be shared instead).
+		 * With parseParallel the members of the object or array that holds most
+		 * of a large text are parsed by several threads (see setThreads()), and
+		 * strings are copied even when parsing in situ
+		 * @param _string NUL terminated JSON text, released by the parser unless parsing in situ
+		 * @param flags Combination of ParseFlags
+		 * @return Root value of the document, empty (Type::None) if it is invalid.
+		 * It belongs to the handler; a copy owns its strings and keys and
+		 * outlives the next parse and the handler
+		 */
+		let& Parse(char* _string = (char*)0, unsigned flags = parseDefault);
+		/** parseText()
+		 * @brief Parses a text that stays with the caller: it is neither
+		 * released nor written, and with parseLazy it must outlive the tree.
+		 * The tree belongs to the handler and is valid until the next parse; it
+		 * is read and changed in place as the one of Parse().
+		 * Objects and arrays of the previous tree are reused, so a handler that
+		 * parses many documents stops allocating once it has seen their sizes
+		 * @param text NUL terminated JSON text
+		 * @param flags Combination of ParseFlags. parseInSitu does not apply
+		 * @return Root value of the document, empty (Type::None) if it is invalid
+		 */
+		let& parseText(const char* text, unsigned flags = parseDefault);
+		/** parseFile()
+		 * @brief Parses a file straight from memory, see MappedFile. With
+		 * parseInSitu the file stays loaded in this handler until the next
+		 * parseFile() or until the handler is destroyed
+		 * @param filePath Path to the JSON file
+		 * @param flags Combination of ParseFlags
+		 * @return Root value of the document, empty (Type::None) if it is invalid
+		 * or the file cannot be opened. It belongs to the handler as in Parse()
+		 */
+		let& parseFile(const char* filePath, unsigned flags = parseDefault);
+		/** feed()
+		 * @brief Parses the next chunk of a document that arrives in pieces. The
+		 * chunk is copied, only its unfinished last token is kept for the next one
+		 * @param data Characters of the chunk, they need no NUL terminator
+		 * @param length Number of characters
+		 * @param flags Combination of ParseFlags, read on the first chunk of a
+		 * document. parseInSitu and parseLazy do not apply
+		 * @return false once the document is known to be invalid
+		 */
+		bool feed(const char* data, size_t length, unsigned flags = parseDefault);
+		/** parseEvents()
+		 * @brief Parses a text without building a tree, reporting its values to
+		 * a handler as they are found (SAX). The text is not released
+		 * @param text NUL terminated JSON text
+		 * @param handler Object with the methods of EventHandler
+		 * @param flags Combination of ParseFlags. parseInSitu and parseLazy do not
+		 * apply. With parseNoIndex a handler that stops early only costs the part
+		 * of the text read so far
+		 * @return true if the whole text was parsed and is valid JSON, false if
+		 * it is invalid or the handler stopped the parser
+		 */
+		template <typename Handler>
+		bool parseEvents(const char* text, Handler& handler, unsigned flags = parseDefault);
+		/** finish()
+		 * @brief Ends the document given to feed()
+		 * @return Root value of the document, empty (Type::None) if it is invalid.
+		 * It belongs to the handler as in Parse()
+		 */
+		let& finish();
+		/** find()
+		 * @brief Finds a value of the last parsed document. Paths used more than
+		 * once are faster compiled into a Query
+		 * @param path JSON Pointer (RFC 6901) as "/features/0/geometry/type", or
+		 * JSONPath query starting with $ (see Query)
+		 * @return First value found, nullptr if there is none or the path is not valid
+		 */
+		const let* find(const String& path) const;
+		// Sets the threads used by parseParallel, 0 for one per hardware thread
+		void setThreads(unsigned count) { threads = count; }
+		/** project()
+		 * @brief Makes Parse(), parseText() and parseFile() build only some values
+		 * of the documents, and the objects and arrays on the way to them. The
+		 * rest is skipped with the structural index: its strings are not copied,
+		 * its numbers not parsed and its errors go unnoticed (see parseLazy).
+		 * Elements of an array before a kept one are null. Projected documents
+		 * are never lazy nor parsed by several threads
+		 * @param paths JSON Pointers, or JSONPath queries made of names and
+		 * positions (see Query). An empty list builds whole documents again
+		 * @return false if a path is not valid or may select several values
+		 * (see getError()), then the previous paths are kept
+		 */
+		bool project(const std::vector<String>& paths);
+		// True if the last parsed text is valid JSON
+		bool isValid() const { return fileIsValid; }
+		// Description of the error of the last parsed text
+		const std::string& getError() const { return errorDescription; }
 		const short int error = -1; // Default error value
 
 	private:
@@ -340,7 +1063,7 @@ namespace json
 		 * @return false If file hasn't .json extension
 		 */
 		bool VerifyIsJson(const char* filepath);
-		/** @brief Parses String value and skips it */
+		/** @brief Parses String value and skips it, leaving it in strPtr and strLen */
 		void ParseString();
 		/** @brief Parses Boolean value and skips it */
 		int ParseBoolean();
@@ -348,11 +1071,107 @@ namespace json
 		int ParseInt();
 		/** @brief Parses integer Number value and skips it */
 		double ParseDecimal();
+		/** @brief Parses Number value and skips it, leaving it in numInt or numDouble
+		 * @return true if the number is an integer that fits in 64 bits */
 		bool ParseNumber();
 		/** @brief Parses Null value and skips it */
 		bool ParseNull();
 		/** @brief Parses Comments and skips them */
 		bool parseComments();
+		/** @brief Clears the state of the previous document, keeping its keys
+		 * and strings when asked (records of a LineReader batch) */
+		void begin(unsigned flags, bool keep = false);
+		/** @brief Counts the lines of Buffer from a position up to idx */
+		void locate(long int from);
+		/** @brief Describes the character at idx as the start of an error */
+		void Log();
+		/** @brief Reports an invalid UTF-8 sequence at a position after idx */
+		bool utf8Error(long int offset);
+		/** parseTokens()
+		 * @brief Main loop of the parser, from idx to the end of Buffer, that
+		 * reports what it finds to a handler (see EventHandler)
+		 * @param last false while streaming: stops before a token that may
+		 * continue in the next chunk
+		 * @param handler Receives the values, the tree builder or the handler
+		 * of parseEvents()
+		 * @return false if the text is invalid or the handler stopped
+		 */
+		template <typename Handler>
+		bool parseTokens(bool last, Handler& handler);
+		/** @brief True if the token at idx ends before the end of Buffer */
+		bool tokenComplete();
+		/** @brief Builds the structural index of Buffer and checks it as UTF-8
+		 * when asked, see ParseFlags */
+		bool indexBuffer();
+		/** @brief Checks that every object and array was closed */
+		void closeDocument();
+		/** @brief Parses the text given to feed(), see parseTokens() */
+		bool parseChunk(bool last);
+		/** @brief Makes content the root of a lazy document, see parseLazy */
+		bool lazyRoot();
+		/** @brief Makes content a lazy value over the whole text once its outer
+		 * brackets are checked, see lazyRoot() */
+		bool lazyContent();
+		/** @brief Builds the values of content kept by project() */
+		bool projectRoot();
+		/** @brief Entry of structurals that closes the object or array opened at an entry */
+		size_t closingEntry(size_t entry) const;
+		/** materialize()
+		 * @brief Parses the members of a lazy object or array, see let::materialize()
+		 * @param value Lazy value, it becomes an obj or Array
+		 */
+		void materialize(let& value);
+		// Node of the paths given to project(): a member or element and the nodes under it
+		struct Projection
+		{
+			String key;					  // Member the node keeps
+			long long index = -1;		  // Element the node keeps, -1 if none
+			bool named = true;			  // The node keeps a member, not only an element
+			bool whole = false;			  // A path ends here, the value is built whole
+			long long last = -1;		  // Greatest index of the children
+			std::vector<size_t> children; // Positions of the nodes under it in projection
+		};
+		/** parseMembers()
+		 * @brief Body of materialize()
+		 * @param value Lazy value, it becomes an obj or Array
+		 * @param node Node of project() that value matched, only the members on
+		 * its paths are built and every nested value is parsed right away.
+		 * nullptr for lazy documents
+		 */
+		void parseMembers(let& value, const Projection* node = nullptr);
+		/** @brief Node under a node of project() that a member (name) or an
+		 * element (position) matches, nullptr if none */
+		const Projection* projected(const Projection& node, const char* name, size_t length, long long position) const;
+		/** @brief Removes the values a node of project() does not keep from a
+		 * built value, for texts parsed without structural index */
+		void prune(let& value, const Projection& node);
+		/** @brief Reports an unexpected entry of structurals in a lazy document */
+		void lazyError(size_t entry);
+		/** parseRecord()
+		 * @brief Parses one record of a JSON Lines text into content, see LineReader
+		 * @param text Characters of the record, they need no NUL terminator
+		 * @param length Number of characters
+		 * @param flags Combination of ParseFlags. parseInSitu and parseLazy do not apply
+		 * @param keep Keeps the keys and strings of the records parsed before
+		 * @return true if the record is valid JSON
+		 */
+		bool parseRecord(const char* text, size_t length, unsigned flags, bool keep);
+		/** @brief Parses Buffer into content once begin() and size are set, see Parse() */
+		bool parseBuffer();
+		/** recycle()
+		 * @brief Empties a value, keeping its objects and arrays for the next
+		 * documents, see openLevel()
+		 * @param value Value of a tree built by this handler
+		 */
+		void recycle(let& value);
+		/** @brief Parses the copy of a text held in pending, see parseRecord() */
+		bool parsePending();
+		/** parseSplit()
+		 * @brief Parses the indexed Buffer with several threads, see parseParallel
+		 * @return false if the text is not worth splitting or is invalid, then
+		 * the handler is ready to parse it again in one piece
+		 */
+		bool parseSplit();
 		std::string errorDescription = "This is a valid JSON",					   // Description of error in case of one
 			filename = "none";													   // Last file validated name
 		std::vector<const char*> expectedValues = { "none" };					   // Values to be expected in the error instance
@@ -367,7 +1186,77 @@ namespace json
 		std::vector<int> arrayLevel;											   // Determines ho many objects are declared in an array to avoid the use of : in an array root
 		bool fileIsValid = true;												   // Determines if file is a valid JSON
 		let content;
-		std::string strValue, numValue, lastValue;
+		std::string strValue;		  // Scratch storage of escaped strings
+		long long numInt = 0;		  // Last parsed integer
+		double numDouble = 0;		  // Last parsed decimal
+		const char* strPtr = nullptr; // Characters of the last parsed string
+		size_t strLen = 0;			  // Length of the last parsed string
+		unsigned flags = parseDefault; // Options of the running Parse()
+		KeyTable keys;				   // Keys of the parsed document
+		Arena strings;				   // String values of the parsed document
+		MappedFile file;			   // File being parsed by parseFile()
+		std::unique_ptr<char[]> lazyText; // Buffer of a lazy document, released by the next parse
+		bool ownsBuffer = true;		   // Parse() releases Buffer when it is not parsing in situ
+		std::vector<let> objLevels;	   // Objects and arrays being parsed, innermost last
+		std::vector<Key> levelKeys; // Key under which every open level is stored in its parent
+		Key key;					// Key of the next object member
+		std::vector<unsigned> structurals; // Structural index of the buffer, see JSONppSimd.h
+		std::vector<size_t> closings;	   // Closing entries of the lazy members of parseMembers()
+		size_t cursor = 0;				   // Next entry of structurals to visit
+		bool indexed = false;			   // Parse() walks structurals instead of every character
+		std::string pending;			   // Text given to feed() that is not parsed yet, or copy of a record
+		size_t streamed = 0;			   // Characters of the stream dropped before pending
+		size_t validated = 0;			   // Characters of pending checked as UTF-8
+		long int scanned = 0;			   // Position where the unfinished token stopped scanning
+		bool streaming = false;			   // feed() is in the middle of a document
+		bool stopped = false;			   // The handler of parseEvents() stopped the parser
+		unsigned threads = 0;			   // Threads of parseParallel, 0 for one per hardware thread
+		std::vector<std::unique_ptr<JSON>> helpers; // Handlers of the slices of parseParallel, they own their keys and strings
+		std::vector<std::unique_ptr<obj>> freeObjects; // Emptied objects of previous trees, see recycle()
+		std::vector<std::unique_ptr<Array>> freeArrays; // Emptied arrays of previous trees
+		std::vector<Projection> projection;				// Nodes of project(), the root first. Empty builds whole documents
+		// Ends parseTokens() on request of its handler
+		bool stop()
+		{
+			stopped = true;
+			return false;
+		}
+		// Parsed string, copied into the document arena unless parsing in situ
+		let stringValue(const char* text, size_t length)
+		{
+			let value;
+			value.setString(flags & parseInSitu ? text : strings.copy(text, length), length);
+			return value;
+		}
+		/** addValue()
+		 * @brief Moves a parsed value into the innermost open level, or to the
+		 * document root when no level is open
+		 * @param value Parsed value
+		 */
+		void addValue(let&& value);
+		/** openLevel()
+		 * @brief Starts an object or array, remembering the key it belongs to.
+		 * Containers emptied by recycle() are used first
+		 * @param isObject true for an object, false for an array
+		 */
+		void openLevel(bool isObject);
+		// Finishes the innermost object or array and moves it to its parent
+		void closeLevel();
+		// Handler of parseTokens() that builds the tree of Parse() and feed()
+		struct Builder
+		{
+			JSON& parser;
+			bool onObjectStart() { return parser.openLevel(true), true; }
+			bool onObjectEnd() { return parser.closeLevel(), true; }
+			bool onArrayStart() { return parser.openLevel(false), true; }
+			bool onArrayEnd() { return parser.closeLevel(), true; }
+			bool onKey(const char* text, size_t length) { return parser.key = parser.keys.intern(text, length), true; }
+			bool onString(const char* text, size_t length) { return parser.addValue(parser.stringValue(text, length)), true; }
+			bool onNumber(long long value) { return parser.addValue(value), true; }
+			bool onNumber(double value) { return parser.addValue(value), true; }
+			bool onBool(bool value) { return parser.addValue(value), true; }
+			bool onNull() { return parser.addValue(nullptr), true; }
+		};
 		int actualvar = 0;
 		//void syncdata(Assign assignate);
 		Bool isRead = true;
@@ -378,125 +1267,875 @@ namespace json
 		bool parse(String buffer);
 	};
 
-	template <typename ID, typename VAL>
-	inline Bool Map<ID, VAL>::hasId(const ID& val) const
+	/** runThreads()
+	 * @brief Runs work(i) for every i below count, each one on its own thread.
+	 * The calling thread runs work(0)
+	 * @param count Number of calls
+	 * @param work Function object called with the number of the call
+	 */
+	template <typename Work>
+	inline void runThreads(size_t count, Work work)
 	{
-		for (auto& i : ids)
-			if (i == val)
-				return true;
-		return false;
+		std::vector<std::thread> threads;
+		for (size_t i = 1; i < count; i++)
+			threads.emplace_back(work, i);
+		if (count > 0)
+			work(0);
+		for (auto& thread : threads)
+			thread.join();
 	}
+
+	/** LineReader class
+	 * @brief Parser of JSON Lines (NDJSON) texts: one JSON document per line.
+	 * Newlines inside strings do not end a record and lines with only
+	 * whitespace are skipped. The threads of the reader first split the text
+	 * into records (see findLineEnds), then parse contiguous batches of
+	 * records, each thread with its own JSON handler
+	 */
+	class LineReader
+	{
+	public:
+		/** LineReader()
+		 * @param threads Number of threads, 0 for one per hardware thread
+		 */
+		explicit LineReader(unsigned threads = 0)
+			: threadCount(threads ? threads : std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1) {}
+		/** parse()
+		 * @brief Parses every record of a text. Keys and strings of the results
+		 * live in the handlers of the reader, so they are valid until the next
+		 * parse() or forEach() or until the reader is destroyed
+		 * @param text Characters of the text, they need no NUL terminator
+		 * @param length Number of characters
+		 * @param flags Combination of ParseFlags. parseInSitu and parseLazy do not apply
+		 * @return Root value of every record, in the order of the text. Invalid
+		 * records are left empty (Type::None), see errors()
+		 */
+		const std::vector<let>& parse(const char* text, size_t length, unsigned flags = parseDefault);
+		/** forEach()
+		 * @brief Parses every record of a text and hands it to a callback
+		 * without keeping it. The callback runs on the threads of the reader:
+		 * the records of a batch arrive in order, batches at the same time
+		 * @param text Characters of the text, they need no NUL terminator
+		 * @param length Number of characters
+		 * @param callback Called as callback(record, value, parser) with the
+		 * position of the record, its root value, valid during the call, and the
+		 * handler that parsed it (see JSON::isValid() and JSON::getError())
+		 * @param flags Combination of ParseFlags. parseInSitu and parseLazy do not apply
+		 * @return Number of records
+		 */
+		template <typename Callback>
+		size_t forEach(const char* text, size_t length, Callback callback, unsigned flags = parseDefault);
+		// Records of the last parse() that are not valid JSON, with the description of their error
+		const std::vector<std::pair<size_t, std::string>>& errors() const { return invalid; }
+
+	private:
+		/** @brief Finds the records of a text and divides them in batches */
+		void split(const char* text, size_t length);
+		unsigned threadCount;									 // Threads that split and parse
+		std::vector<std::unique_ptr<JSON>> handlers;			 // Handler of every batch, kept between calls
+		std::vector<std::vector<size_t>> ends;					 // Newlines of every range, see findLineEnds()
+		std::vector<std::pair<size_t, size_t>> lines;			 // Start and end of every record
+		std::vector<size_t> batches;							 // First record of every batch, then the number of records
+		std::vector<let> records;								 // Results of parse()
+		std::vector<std::pair<size_t, std::string>> invalid;	 // Errors of parse()
+	};
+
+	/** Query class
+	 * @brief Path to values of a tree, compiled once and evaluated on any number
+	 * of trees. Two syntaxes are accepted:
+	 * - JSON Pointer (RFC 6901): "" or "/features/0/geometry/type"
+	 * - JSONPath: "$.store.book[0].title", "$..author", "$.a[*]", "$.a[-1]",
+	 * "$.a[1:5:2]", "$['a','b']" and filters as "$.book[?(@.price < 10 && @.isbn)]",
+	 * with == != < <= > >=, && || ! and parentheses over relative (@) or absolute
+	 * ($) paths and literal numbers, strings, true, false and null
+	 * Keys are unescaped and hashed when compiling, so evaluating a query does no
+	 * string work, and queries that name single values walk the tree directly
+	 */
+	class Query
+	{
+	public:
+		Query() = default;
+		/** Query()
+		 * @param path JSON Pointer or JSONPath query, see isValid()
+		 */
+		explicit Query(const String& path) { compile(path); }
+		/** compile()
+		 * @brief Compiles a path, replacing the previous one
+		 * @param path JSON Pointer, or JSONPath query starting with $
+		 * @return false if the path is not valid (see getError())
+		 */
+		bool compile(const String& path);
+		/** first()
+		 * @brief Finds the first value of a tree the query selects
+		 * @param root Root of the tree
+		 * @return The value, nullptr if there is none
+		 */
+		const let* first(const let& root) const;
+		/** evaluate()
+		 * @brief Finds every value of a tree the query selects, in the order of
+		 * the query selectors, each of them in document order
+		 * @param root Root of the tree
+		 * @param out Receives the values, after the ones it holds
+		 * @return Number of values found
+		 */
+		size_t evaluate(const let& root, std::vector<const let*>& out) const;
+		// Returns true if the last compile() succeeded
+		bool isValid() const { return valid; }
+		// Description of the last compile() error
+		const std::string& getError() const { return errorDescription; }
+
+	private:
+		friend class JSON;
+		// Selector of a step: a key, a position or a group of children
+		struct Selector
+		{
+			enum Kind : unsigned char
+			{
+				Key,	  // Member of an object
+				Index,	  // Element of an array, negative from the end
+				Token,	  // JSON Pointer token: a member, or an element if it is a position
+				Wildcard, // Every member or element
+				Slice,	  // Elements from start to end by step
+				Filter	  // Children for which an expression is true
+			} kind;
+			String key;			 // Unescaped key of Key and Token
+			size_t hash = 0;	 // Hash of the key, see MapKey
+			long long index = 0; // Position of Index and Token (-1 if it is not one), start of Slice
+			long long end = 0;	 // End of Slice
+			long long step = 1;	 // Step of Slice
+			bool hasIndex = false, hasEnd = false;
+			size_t expression = 0; // Root expression of Filter
+		};
+		// Selectors applied to every value selected by the previous step
+		struct Step
+		{
+			std::vector<Selector> selectors;
+			bool descendants = false; // .. : the value and all its descendants
+		};
+		// Node of a filter expression
+		struct Expression
+		{
+			enum Kind : unsigned char
+			{
+				Or,
+				And,
+				Not,
+				Exists,		// The path selects something
+				Compare,	// left op right
+				Path,		// Operand: first value of a path
+				Literal		// Operand: constant
+			} kind;
+			char op[3] = {};	  // == != < <= > >= of Compare
+			size_t left = 0;	  // Operand or subexpression
+			size_t right = 0;	  // Operand or subexpression
+			size_t path = 0;	  // Steps of Path and Exists in paths
+			bool relative = true; // Path from @ instead of $
+			let literal;		  // Value of Literal
+		};
+		// Text being compiled
+		struct Cursor
+		{
+			const String& text;
+			size_t at;
+			char peek() const { return at < text.size() ? text[at] : '\0'; }
+			void skipSpace()
+			{
+				while (at < text.size() && isspace((unsigned char)text[at]))
+					at++;
+			}
+			bool eat(const char* token)
+			{
+				skipSpace();
+				size_t length = strlen(token);
+				if (text.compare(at, length, token) != 0)
+					return false;
+				return at += length, true;
+			}
+		};
+		bool compilePointer(const String& path);
+		bool compileSteps(Cursor& in, std::vector<Step>& steps, bool inFilter);
+		bool compileBracket(Cursor& in, Step& step);
+		bool compileSelector(Cursor& in, Selector& selector);
+		bool compileString(Cursor& in, String& out);
+		bool compileInteger(Cursor& in, long long& out);
+		bool compileOr(Cursor& in, size_t& node);
+		bool compileAnd(Cursor& in, size_t& node);
+		bool compileUnary(Cursor& in, size_t& node);
+		bool compileOperand(Cursor& in, size_t& node);
+		bool fail(const char* description, const Cursor& in);
+		static void setKey(Selector& selector, const String& key);
+		static bool isSingular(const std::vector<Step>& steps);
+
+		const let* walk(const std::vector<Step>& steps, const let& from) const;
+		void run(const std::vector<Step>& steps, const let& from, const let& root, std::vector<const let*>& out) const;
+		void select(const Selector& selector, const let& value, const let& root, std::vector<const let*>& out) const;
+		void descend(const Step& step, const let& value, const let& root, std::vector<const let*>& out) const;
+		const let* child(const Selector& selector, const let& value) const;
+		bool test(size_t expression, const let& current, const let& root) const;
+		const let* operand(size_t expression, const let& current, const let& root) const;
+		static bool equal(const let& a, const let& b);
+		static int compare(const let& a, const let& b);
+
+		std::vector<Step> steps;				 // Steps of the query
+		std::vector<std::vector<Step>> paths;	 // Steps of the paths of filters
+		std::vector<Expression> expressions;	 // Nodes of the filters
+		bool singular = true;					 // Every step selects one key or position
+		bool valid = true;						 // Result of the last compile()
+		std::string errorDescription;			 // Description of the last error
+	};
+
 	template <typename ID, typename VAL>
-	inline Bool Map<ID, VAL>::hasValue(const VAL& val) const
+	inline void Map<ID, VAL>::buildIndex() const
 	{
-		for (auto& i : values)
-			if (i == val)
-				return true;
-		return false;
+		size_t capacity = 2 * indexThreshold;
+		while (capacity < 2 * ids.size())
+			capacity <<= 1;
+		index.assign(capacity, 0);
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			size_t slot = slotOf(MapKey<ID>::hash(ids[i]));
+			while (index[slot] != 0 && !MapKey<ID>::equal(ids[index[slot] - 1], ids[i]))
+				slot = (slot + 1) & (index.size() - 1);
+			if (index[slot] == 0) // Repeated ids keep pointing to the first one
+				index[slot] = (unsigned)i + 1;
+		}
 	}
 	template <typename ID, typename VAL>
-	inline VAL& Map<ID, VAL>::operator[](ID& idx)
+	inline void Map<ID, VAL>::indexLast()
 	{
-		size_t i = 0;
-		for (i = 0; i < values.size(); ++i)
-			if (ids[i] == idx)
-				return values[i];
-		insert(idx, nullptr);
-		return values.back();
+		if (index.empty())
+			return;
+		if (2 * ids.size() > index.size())
+			return buildIndex();
+		size_t slot = slotOf(MapKey<ID>::hash(ids.back()));
+		while (index[slot] != 0)
+		{
+			if (MapKey<ID>::equal(ids[index[slot] - 1], ids.back()))
+				return;
+			slot = (slot + 1) & (index.size() - 1);
+		}
+		index[slot] = (unsigned)ids.size();
 	}
-
 	template <typename ID, typename VAL>
-	inline size_t Map<ID, VAL>::find(ID& idx) const
+	inline void Map<ID, VAL>::unindexLast()
 	{
-		size_t i = 0;
-		for (i = 0; i < values.size(); ++i)
-			if (ids[i] == idx)
-				return i;
-		return -1;
-	}
-	template <typename T>
-	inline T let::getValue()
-	{
-		//T out = {};
-		const char* id = typeid(T).name();
-		if ((id == typenames[0] or id == typenames[1] or id == typenames[2] or
-			id == typenames[3] or id == typenames[4] or id == typenames[5]) and
-			idx == 0)
-			return *(T*)(char*)&_str;
-		else if ((id == typenames[6] or id == typenames[7]) and idx == 1)
-			return *(T*)&_bool;
-		else if ((id == typenames[8] or id == typenames[9]) and idx == 2)
-			return *(T*)&_int;
-		else if ((id == typenames[10] or id == typenames[11]) and idx == 3)
-			return *(T*)&_float;
-		else if ((id == typenames[12] or id == typenames[13] or id == typenames[14] or id == typenames[15]) and idx == 4)
-			return *(T*)&_double;
-		else if ((id == typenames[16] or id == typenames[17]) and idx == 5)
-			return *(T*)(&_array);
-		else if ((id == typenames[18] or id == typenames[19]) and idx == 6)
-			return *(T*)&_obj;
-		else if (id == typenames[20] and idx == -1)
-			return *(T*)&_null;
-		return T();
-		//return out;
+		if (index.empty() || ids.empty())
+			return;
+		size_t mask = index.size() - 1, slot = slotOf(MapKey<ID>::hash(ids.back()));
+		while (index[slot] != 0 && index[slot] != ids.size())
+			slot = (slot + 1) & mask;
+		if (index[slot] == 0)
+			return;
+		// Backward shift deletion keeps every probe sequence free of holes
+		size_t next = (slot + 1) & mask;
+		while (index[next] != 0)
+		{
+			size_t home = slotOf(MapKey<ID>::hash(ids[index[next] - 1]));
+			if (((next - home) & mask) >= ((next - slot) & mask))
+				index[slot] = index[next], slot = next;
+			next = (next + 1) & mask;
+		}
+		index[slot] = 0;
 	}
-	template <typename T>
-	inline let& let::setValue(T* value)
+	template <typename ID, typename VAL>
+	inline size_t Map<ID, VAL>::lookup(const ID& id, size_t hash) const
 	{
-		clear();
-		auto id = typeid(T).name();
-		if (id == typenames[0] or id == typenames[1] or id == typenames[2] or
-			id == typenames[3] or id == typenames[4] or id == typenames[5])
-		{
-			_str = (const char*)value; //new (&_str) String((char*)value);
-			type = Type::String, idx = 0;
-		}
-		else if (id == typenames[6] or id == typenames[7])
-			_bool = *(Bool*)value, type = Type::Boolean, idx = 1;
-		else if (id == typenames[8] or id == typenames[9])
-			_int = *(int*)value, type = Type::Number, idx = 2;
-		else if (id == typenames[10] or id == typenames[11])
-			_float = *(float*)value, type = Type::Number, idx = 3;
-		else if ((id == typenames[12] or id == typenames[13] or id == typenames[14] or id == typenames[15]))
-			_double = *(double*)value, type = Type::Number, idx = 4;
-		else if (id == typenames[16] or id == typenames[17])
-			_array = *(Array*)value, type = Type::Array, idx = 5;
-		else if (id == typenames[18] or id == typenames[19])
-			_obj = *(obj*)value, type = Type::Object, idx = 6;
-		else if (id == typenames[20])
-			_null = nullptr, type = Type::Null, idx = -1;
-		else if (id == typenames[21] or id == typenames[22])
-			*this = *value;
+		if (ids.size() <= indexThreshold)
+		{
+			size_t i = 0;
+			for (i = 0; i < ids.size(); ++i)
+				if (MapKey<ID>::equal(ids[i], id))
+					return i;
+			return i;
+		}
+		if (index.empty())
+			buildIndex();
+		size_t slot = slotOf(hash);
+		while (index[slot] != 0)
+		{
+			if (MapKey<ID>::equal(ids[index[slot] - 1], id))
+				return index[slot] - 1;
+			slot = (slot + 1) & (index.size() - 1);
+		}
+		return ids.size();
+	}
+	template <typename ID, typename VAL>
+	inline Bool Map<ID, VAL>::hasId(const ID& val) const
+	{
+		return lookup(val) < ids.size();
+	}
+	template <typename ID, typename VAL>
+	inline Bool Map<ID, VAL>::hasValue(const VAL& val) const
+	{
+		for (auto& i : values)
+			if (i == val)
+				return true;
+		return false;
+	}
+	template <typename ID, typename VAL>
+	inline VAL& Map<ID, VAL>::operator[](const ID& idx)
+	{
+		size_t i = lookup(idx);
+		if (i < values.size())
+			return values[i];
+		insert(idx, nullptr);
+		return values.back();
+	}
 
+	template <typename ID, typename VAL>
+	inline size_t Map<ID, VAL>::find(const ID& idx) const
+	{
+		size_t i = lookup(idx);
+		return i < ids.size() ? i : -1;
+	}
+	inline let& let::setValue(const String& value)
+	{
+		// std::string values are copied, the let owns the characters
+		char* copy = new char[value.size() + 1];
+		memcpy(copy, value.c_str(), value.size() + 1);
+		setString(copy, value.size());
+		owned = true;
+		return *this;
+	}
+	inline obj::obj(const obj& other) : values(other.values)
+	{
+		// All the keys go in one block
+		size_t total = 0;
+		for (size_t i = 0; i < values.Size(); i++)
+			total += values.getId(i).len + 1;
+		if (total == 0)
+			return;
+		keys.emplace_back(new char[total]);
+		char* next = keys.back().get();
+		for (size_t i = 0; i < values.Size(); i++)
+		{
+			Key key = values.getId(i);
+			memcpy(next, key.str, key.len), next[key.len] = '\0';
+			values.setId(i, Key(next, key.len));
+			next += key.len + 1;
+		}
+	}
+	inline obj& obj::operator=(const obj& other)
+	{
+		if (this != &other)
+		{
+			obj copy(other);
+			*this = std::move(copy);
+		}
 		return *this;
 	}
+	inline Key obj::ownKey(const char* key, size_t len)
+	{
+		char* copy = new char[len + 1];
+		memcpy(copy, key, len), copy[len] = '\0';
+		keys.emplace_back(copy);
+		return Key(copy, len);
+	}
+	inline let& obj::operator[](const char* name)
+	{
+		size_t i = values.find(name);
+		if (i != (size_t)-1)
+			return values[i];
+		values.insert(ownKey(name, strlen(name)), nullptr);
+		return values[values.Size() - 1];
+	}
+	inline let& obj::addValue(const Key& name, const let& val)
+	{
+		size_t i = values.find(name);
+		if (i != (size_t)-1)
+			return values[i] = val;
+		values.insert(name, val);
+		return values[values.Size() - 1];
+	}
+	inline let& obj::addValue(const Key& name, let&& val)
+	{
+		size_t i = values.find(name);
+		if (i != (size_t)-1)
+			return values[i] = std::move(val);
+		return values.emplace(name, std::move(val));
+	}
+	template <typename T>
+	inline let& obj::emplace(const char* name, T&& value)
+	{
+		size_t i = values.find(name);
+		if (i != (size_t)-1)
+			return values[i] = std::forward<T>(value);
+		return values.emplace(ownKey(name, strlen(name)), std::forward<T>(value));
+	}
+	inline void JSON::addValue(let&& value)
+	{
+		if (objLevels.empty())
+			content = std::move(value);
+		else if (objLevels.back().idx == 5)
+			objLevels.back()._array->emplace_back(std::move(value));
+		else if (key)
+		{
+			if (let* member = objLevels.back()._obj->addMember(key))
+				member->take(value);
+			else
+				recycle(value); // Repeated key
+		}
+	}
+	inline void JSON::openLevel(bool isObject)
+	{
+		objLevels.emplace_back();
+		let& level = objLevels.back();
+		if (isObject)
+		{
+			level._obj = freeObjects.empty() ? new obj() : freeObjects.back().release();
+			level.idx = 6, level.type = Type::Object;
+			if (!freeObjects.empty())
+				freeObjects.pop_back();
+		}
+		else
+		{
+			level._array = freeArrays.empty() ? new Array() : freeArrays.back().release();
+			level.idx = 5, level.type = Type::Array;
+			if (!freeArrays.empty())
+				freeArrays.pop_back();
+		}
+		levelKeys.push_back(key);
+	}
+	inline void JSON::closeLevel()
+	{
+		if (objLevels.empty())
+			return;
+		let value(std::move(objLevels.back()));
+		key = levelKeys.back();
+		objLevels.pop_back(), levelKeys.pop_back();
+		addValue(std::move(value));
+	}
+	inline void JSON::recycle(let& value)
+	{
+		// Children go first and in reverse, so the next document gets the
+		// containers back in the order it opens them
+		if (value.idx == 5)
+		{
+			Array& items = *value._array;
+			for (size_t i = items.size(); i-- > 0;)
+				recycle(items[i]);
+			items.clear();
+			freeArrays.emplace_back(value._array);
+			value.idx = -1;
+		}
+		else if (value.idx == 6)
+		{
+			Map<Key, let>& members = value._obj->values;
+			for (size_t i = members.Size(); i-- > 0;)
+				recycle(members[i]);
+			members.clear();
+			value._obj->keys.clear(); // Keys inserted by user code
+			freeObjects.emplace_back(value._obj);
+			value.idx = -1;
+		}
+		value.clear();
+	}
+	inline size_t let::size() const
+	{
+		materialize();
+		switch (idx)
+		{
+		case 0:
+			return _len;
+		case 5:
+			return _array->size();
+		case 6:
+			return _obj->values.Size();
+		default:
+			return 0;
+		}
+	}
 	inline let& let::setObject(obj* obj)
 	{
 		clear();
-		_obj = *obj;
+		_obj = new json::obj(*obj);
 		type = Type::Object;
 		idx = 6;
 		return *this;
 	}
+	inline void let::assign(const let& other)
+	{
+		// The index of a lazy value is replaced by the next parse of its handler,
+		// so copies get parsed members (nested lazy ones too, through the copy)
+		other.materialize();
+		switch (other.idx)
+		{
+		case 0:
+		{
+			char* copy = new char[other._len + 1];
+			memcpy(copy, other._str, other._len), copy[other._len] = '\0';
+			_str = copy, owned = true;
+			break;
+		}
+		case 5:
+			_array = new Array(*other._array);
+			break;
+		case 6:
+			_obj = new obj(*other._obj);
+			break;
+		default:
+			memcpy((void*)&_double, (const void*)&other._double, sizeof(_double));
+			break;
+		}
+		_len = other._len, idx = other.idx, type = other.type;
+	}
+	inline void let::take(let& other)
+	{
+		memcpy((void*)&_double, (const void*)&other._double, sizeof(_double));
+		_len = other._len, idx = other.idx, type = other.type, owned = other.owned;
+		other.idx = -1, other.type = Type::None, other.owned = false;
+	}
 	inline void let::clear()
 	{
-		//free((void *)_str);
-		//_str = "";
-		if (idx == 5)
-			_array.~vector();
+		if (idx == 0 && owned)
+			delete[] _str;
+		else if (idx == 5)
+			delete _array;
 		else if (idx == 6)
-			_obj.~obj();
-		else
-			_null = null;
+			delete _obj;
+		_null = null;
+		owned = false;
 		type = Type::None;
-		//_int = 0;
-		//_bool = 0;
-		//_double = 0;
-		//_float = 0;
+		_len = 0;
 		idx = -1;
 	}
-	inline std::ostream& operator<<(std::ostream& os, let& _let)
+	/** mulHigh()
+	 * @brief Full 64x64 bits multiplication
+	 * @param a First factor
+	 * @param b Second factor
+	 * @param low Receives the low 64 bits of the product
+	 * @return High 64 bits of the product
+	 */
+	inline unsigned long long mulHigh(unsigned long long a, unsigned long long b, unsigned long long& low)
+	{
+#if defined(__SIZEOF_INT128__)
+		unsigned __int128 r = (unsigned __int128)a * b;
+		low = (unsigned long long)r;
+		return (unsigned long long)(r >> 64);
+#else
+		unsigned long long aLow = a & 0xffffffff, aHigh = a >> 32, bLow = b & 0xffffffff, bHigh = b >> 32;
+		unsigned long long ll = aLow * bLow, lh = aLow * bHigh, hl = aHigh * bLow, hh = aHigh * bHigh;
+		unsigned long long middle = (ll >> 32) + (lh & 0xffffffff) + (hl & 0xffffffff);
+		low = (middle << 32) | (ll & 0xffffffff);
+		return hh + (lh >> 32) + (hl >> 32) + (middle >> 32);
+#endif
+	}
+
+	// Number of leading zero bits of a non zero value
+	inline int leadingZeros(unsigned long long value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_clzll(value);
+#else
+		int n = 0;
+		while (!(value & (1ULL << 63)))
+			value <<= 1, n++;
+		return n;
+#endif
+	}
+
+	/** eiselLemire()
+	 * @brief Converts w * 10^q to the nearest double with the Eisel-Lemire
+	 * algorithm, using the truncated powers of five of JSONppTables.h
+	 * @param w Decimal significand, non zero and of at most 19 digits
+	 * @param q Decimal exponent
+	 * @param out Receives the positive result
+	 * @return false if the result is subnormal or cannot be decided, the caller
+	 * must then use a slow path
+	 */
+	inline bool eiselLemire(unsigned long long w, long long q, double& out)
+	{
+		if (q < smallestPowerOfFive)
+			return out = 0, true;
+		if (q > largestPowerOfFive)
+			return out = HUGE_VAL, true;
+		int lz = leadingZeros(w);
+		w <<= lz;
+		const unsigned long long* power = powersOfFive() + 2 * (q - smallestPowerOfFive);
+		unsigned long long low, high = mulHigh(w, power[0], low);
+		if ((high & 0x1ff) == 0x1ff)
+		{
+			// The 55 most significant bits may be off by one, refine with the lower word
+			unsigned long long secondLow, secondHigh = mulHigh(w, power[1], secondLow);
+			low += secondHigh;
+			if (secondHigh > low)
+				high++;
+			if ((high & 0x1ff) == 0x1ff && low + 1 == 0)
+				return false;
+		}
+		int upperBit = (int)(high >> 63);
+		int shift = upperBit + 64 - 52 - 3;
+		unsigned long long mantissa = high >> shift;
+		long long power2 = (((152170 + 65536) * q) >> 16) + 63 + upperBit - lz + 1023;
+		if (power2 <= 0)
+			return false;
+		// Exactly halfway between two doubles: round to even
+		if (low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == high)
+			mantissa &= ~1ULL;
+		mantissa += mantissa & 1;
+		mantissa >>= 1;
+		if (mantissa >= (2ULL << 52))
+			mantissa = 1ULL << 52, power2++;
+		mantissa &= ~(1ULL << 52);
+		if (power2 >= 0x7ff)
+			return out = HUGE_VAL, true;
+		unsigned long long bits = mantissa | ((unsigned long long)power2 << 52);
+		memcpy(&out, &bits, sizeof(out));
+		return true;
+	}
+
+	/** DiyFp struct
+	 * @brief Floating point number with a 64 bits significand, value = f * 2^e
+	 */
+	struct DiyFp
+	{
+		unsigned long long f; // Significand
+		int e;				  // Binary exponent
+		DiyFp(unsigned long long _f, int _e) : f(_f), e(_e) {}
+		static DiyFp sub(const DiyFp& x, const DiyFp& y) { return DiyFp(x.f - y.f, x.e); }
+		// Product rounded to 64 bits, ties up
+		static DiyFp mul(const DiyFp& x, const DiyFp& y)
+		{
+			unsigned long long low, high = mulHigh(x.f, y.f, low);
+			return DiyFp(high + (low >> 63), x.e + y.e + 64);
+		}
+		static DiyFp normalize(const DiyFp& x)
+		{
+			int lz = leadingZeros(x.f);
+			return DiyFp(x.f << lz, x.e - lz);
+		}
+		static DiyFp normalizeTo(const DiyFp& x, int e) { return DiyFp(x.f << (x.e - e), e); }
+	};
+
+	/** computeBoundaries()
+	 * @brief Normalized value and boundaries of the rounding interval of a
+	 * positive finite float or double
+	 * @param value Number to decompose
+	 * @param w Receives the normalized value
+	 * @param minus Receives the lower boundary, with the exponent of plus
+	 * @param plus Receives the normalized upper boundary
+	 */
+	template <typename FloatType>
+	inline void computeBoundaries(FloatType value, DiyFp& w, DiyFp& minus, DiyFp& plus)
+	{
+		const int precision = std::numeric_limits<FloatType>::digits; // Including the hidden bit
+		const int bias = std::numeric_limits<FloatType>::max_exponent - 1 + (precision - 1);
+		const unsigned long long hidden = 1ULL << (precision - 1);
+		unsigned long long bits = 0;
+		if (sizeof(FloatType) == sizeof(unsigned long long))
+			memcpy(&bits, &value, sizeof(bits));
+		else
+		{
+			unsigned int bits32;
+			memcpy(&bits32, &value, sizeof(bits32));
+			bits = bits32;
+		}
+		unsigned long long E = bits >> (precision - 1), F = bits & (hidden - 1);
+		DiyFp v = E == 0 ? DiyFp(F, 1 - bias) : DiyFp(F + hidden, (int)E - bias);
+		bool lowerIsCloser = F == 0 && E > 1;
+		plus = DiyFp::normalize(DiyFp(2 * v.f + 1, v.e - 1));
+		minus = DiyFp::normalizeTo(lowerIsCloser ? DiyFp(4 * v.f - 1, v.e - 2) : DiyFp(2 * v.f - 1, v.e - 1), plus.e);
+		w = DiyFp::normalize(v);
+	}
+
+	// Rounds the last generated digit towards the value while it stays inside the interval
+	inline void grisu2Round(char* buffer, int length, unsigned long long dist, unsigned long long delta,
+							unsigned long long rest, unsigned long long tenK)
+	{
+		while (rest < dist && delta - rest >= tenK && (rest + tenK < dist || dist - rest > rest + tenK - dist))
+			buffer[length - 1]--, rest += tenK;
+	}
+
+	/** grisu2()
+	 * @brief Generates the decimal digits of a positive finite number with the
+	 * Grisu2 algorithm. The digits always read back to the same number and are
+	 * the shortest such digits in all but a tiny fraction of the inputs, which
+	 * are reported: Grisu2 only proves digits a little inside the rounding
+	 * interval, and its boundaries, which read back to the number when its
+	 * significand is even (1e23), are never proven
+	 * @param buffer Receives the digits, without dot nor exponent (17 at most)
+	 * @param length Receives the number of digits
+	 * @param exponent Receives the decimal exponent: value = digits * 10^exponent
+	 * @param value Number to convert
+	 * @return false if shorter digits may read back too, see shortestDigits()
+	 */
+	template <typename FloatType>
+	inline bool grisu2(char* buffer, int& length, int& exponent, FloatType value)
+	{
+		DiyFp v(0, 0), mMinus(0, 0), mPlus(0, 0);
+		computeBoundaries(value, v, mMinus, mPlus);
+		// Scale by a cached power of ten so the upper boundary exponent lands in [-60, -32]
+		int f = -60 - mPlus.e - 1;
+		int k = (f * 78913) / (1 << 18) + (f > 0);
+		const CachedPower& cached = cachedPowers()[(-cachedPowersMinDecExp + k + (cachedPowersDecStep - 1)) / cachedPowersDecStep];
+		DiyFp c(cached.f, cached.e);
+		DiyFp w = DiyFp::mul(v, c), wMinus = DiyFp::mul(mMinus, c), wPlus = DiyFp::mul(mPlus, c);
+		DiyFp low(wMinus.f + 1, wMinus.e), high(wPlus.f - 1, wPlus.e);
+		exponent = -cached.k;
+		length = 0;
+
+		unsigned long long delta = DiyFp::sub(high, low).f, dist = DiyFp::sub(high, w).f;
+		const DiyFp one(1ULL << -high.e, high.e);
+		unsigned int p1 = (unsigned int)(high.f >> -one.e);
+		unsigned long long p2 = high.f & (one.f - 1);
+		// Integral digits
+		unsigned int pow10 = 1;
+		int n = 1;
+		while (n < 10 && p1 >= pow10 * 10)
+			pow10 *= 10, n++;
+		// The boundaries are known within 1 unit and low and high are 1 unit
+		// inside: digits that stop within 2 units outside them may read back
+		bool proven = true;
+		while (n > 0)
+		{
+			buffer[length++] = (char)('0' + p1 / pow10);
+			p1 %= pow10;
+			n--;
+			unsigned long long rest = ((unsigned long long)p1 << -one.e) + p2, tenK = (unsigned long long)pow10 << -one.e;
+			if (rest <= delta)
+			{
+				exponent += n;
+				grisu2Round(buffer, length, dist, delta, rest, tenK);
+				return proven;
+			}
+			proven = proven && rest - delta > 2 && tenK - rest > 2;
+			pow10 /= 10;
+		}
+		// Fractional digits, the unit grows with delta
+		int m = 0;
+		unsigned long long unit = 1;
+		do
+		{
+			p2 *= 10;
+			buffer[length++] = (char)('0' + (p2 >> -one.e));
+			p2 &= one.f - 1;
+			m++;
+			delta *= 10, dist *= 10, unit *= 10;
+			proven = proven && (p2 <= delta || (p2 - delta > 2 * unit && one.f - p2 > 2 * unit));
+		} while (p2 > delta);
+		exponent -= m;
+		grisu2Round(buffer, length, dist, delta, p2, one.f);
+		return proven;
+	}
+
+	// True if a text reads back to the same number, see shortestDigits()
+	inline bool readsBack(const char* text, double value) { return strtod(text, nullptr) == value; }
+	inline bool readsBack(const char* text, float value) { return strtof(text, nullptr) == value; }
+
+	/** shortestDigits()
+	 * @brief Looks for fewer digits than grisu2() found when it could not prove
+	 * them the shortest, rounding the number to 1, 2... digits until one reads
+	 * back to it
+	 * @param buffer Digits of grisu2(), replaced by the shorter ones if any
+	 * @param length Number of digits, updated
+	 * @param exponent Decimal exponent, updated
+	 * @param value Positive finite number
+	 */
+	template <typename FloatType>
+	inline void shortestDigits(char* buffer, int& length, int& exponent, FloatType value)
+	{
+		char text[32];
+		for (int digits = 1; digits < length; digits++)
+		{
+			snprintf(text, sizeof(text), "%.*e", digits - 1, (double)value);
+			if (!readsBack(text, value))
+				continue;
+			// d.ddde+x, the decimal point depends on the locale
+			const char* e = strchr(text, 'e');
+			length = 0;
+			for (const char* p = text; p < e; p++)
+				if (*p >= '0' && *p <= '9')
+					buffer[length++] = *p;
+			exponent = atoi(e + 1) - (length - 1);
+			return;
+		}
+	}
+
+	/** dtoa()
+	 * @brief Writes the shortest JSON text that reads back to the same number.
+	 * Decimals keep a fraction or exponent ("1.0", "1e+21"), infinities and
+	 * NaN, which JSON cannot represent, are written as null
+	 * @param buffer Destination, at least 32 characters
+	 * @param value Number to write
+	 * @return End of the written text
+	 */
+	template <typename FloatType>
+	inline char* dtoa(char* buffer, FloatType value)
+	{
+		if (!std::isfinite(value))
+			return memcpy(buffer, "null", 4), buffer + 4;
+		if (std::signbit(value))
+			*buffer++ = '-', value = -value;
+		if (value == 0)
+			return memcpy(buffer, "0.0", 3), buffer + 3;
+		int k = 0, exponent = 0;
+		if (!grisu2(buffer, k, exponent, value))
+			shortestDigits(buffer, k, exponent, value);
+		// Same layout as JavaScript: positional notation for 1e-6 <= value < 1e21
+		int n = k + exponent;
+		if (k <= n && n <= 21)
+		{
+			memset(buffer + k, '0', n - k);
+			buffer[n] = '.', buffer[n + 1] = '0';
+			return buffer + n + 2;
+		}
+		if (0 < n && n <= 21)
+		{
+			memmove(buffer + n + 1, buffer + n, k - n);
+			buffer[n] = '.';
+			return buffer + k + 1;
+		}
+		if (-6 < n && n <= 0)
+		{
+			memmove(buffer + 2 - n, buffer, k);
+			buffer[0] = '0', buffer[1] = '.';
+			memset(buffer + 2, '0', -n);
+			return buffer + 2 - n + k;
+		}
+		if (k > 1)
+		{
+			memmove(buffer + 2, buffer + 1, k - 1);
+			buffer[1] = '.';
+			buffer += k + 1;
+		}
+		else
+			buffer++;
+		*buffer++ = 'e';
+		int e = n - 1;
+		*buffer++ = e < 0 ? '-' : '+';
+		e = e < 0 ? -e : e;
+		if (e >= 100)
+			*buffer++ = (char)('0' + e / 100), e %= 100, *buffer++ = (char)('0' + e / 10);
+		else if (e >= 10)
+			*buffer++ = (char)('0' + e / 10);
+		*buffer++ = (char)('0' + e % 10);
+		return buffer;
+	}
+
+	/** i64toa()
+	 * @brief Writes an integer in decimal
+	 * @param buffer Destination, at least 20 characters
+	 * @param value Number to write
+	 * @return End of the written text
+	 */
+	inline char* i64toa(char* buffer, long long value)
+	{
+		unsigned long long u = value < 0 ? 0 - (unsigned long long)value : (unsigned long long)value;
+		if (value < 0)
+			*buffer++ = '-';
+		char digits[20];
+		int n = 0;
+		do
+			digits[n++] = (char)('0' + u % 10);
+		while (u /= 10);
+		while (n)
+			*buffer++ = digits[--n];
+		return buffer;
+	}
+
+	inline std::ostream& operator<<(std::ostream& os, const let& _let)
 	{
+		char number[32];
 		switch (_let.index())
 		{
 		case 0:
@@ -506,19 +2145,19 @@ namespace json
 			os << (_let._bool ? "true" : "false");
 			break;
 		case 2:
-			os << _let._int;
+			os.write(number, i64toa(number, _let._int) - number);
 			break;
 		case 3:
-			os << _let._float;
+			os.write(number, dtoa(number, _let._float) - number);
 			break;
 		case 4:
-			os << _let._double;
+			os.write(number, dtoa(number, _let._double) - number);
 			break;
 		case 6:
-			os << _let._obj;
+			os << *_let._obj;
 			break;
 		case 5:
-			os << _let._array;
+			os << *_let._array;
 			break;
 		default:
 			os << "null";
@@ -527,7 +2166,7 @@ namespace json
 		return os;
 	}
 
-	inline std::ostream& operator<<(std::ostream& os, obj obj)
+	inline std::ostream& operator<<(std::ostream& os, const obj& obj)
 	{
 		n_tab += 2;
 		os << "{ \n";
@@ -535,7 +2174,9 @@ namespace json
 		{
 			for (int i = 0; i < n_tab; i++)
 				os << "  ";
-			os << "\"" << bold(obj.values.getId(i)) << "\": " << obj.values[i];
+			Key key = obj.values.getId(i);
+			os << "\"\x1b[1m";
+			os.write(key.str, key.len) << "\x1b[0m\": " << obj.values[i];
 			if (i < obj.values.Size() - 1)
 				os << ", ";
 			os << "\n";
@@ -548,7 +2189,7 @@ namespace json
 	}
 
 	template <typename T>
-	inline std::ostream& operator<<(std::ostream& os, std::vector<T> arr)
+	inline std::ostream& operator<<(std::ostream& os, const std::vector<T>& arr)
 	{
 		os << "[ ";
 		for (size_t i = 0; i < arr.size(); i++)
@@ -561,88 +2202,485 @@ namespace json
 		return os;
 	}
 
-	inline String tolow(String value)
+	/** StringSink struct
+	 * @brief Writer sink that appends the text to a String
+	 */
+	struct StringSink
 	{
-		for (auto& i : value)
-			i = tolower(i);
-		return value;
-	}
+		String& out;
+		explicit StringSink(String& _out) : out(_out) {}
+		void write(const char* data, size_t length) { out.append(data, length); }
+	};
 
-	inline String toup(String value)
+	/** StreamSink struct
+	 * @brief Writer sink that sends the text to a std::ostream
+	 */
+	struct StreamSink
 	{
-		for (auto& i : value)
-			i = toupper(i);
-		return value;
-	}
+		std::ostream& os;
+		explicit StreamSink(std::ostream& _os) : os(_os) {}
+		void write(const char* data, size_t length) { os.write(data, (std::streamsize)length); }
+	};
 
-	inline bool JSON::parseComments()
+	/** Writer class
+	 * @brief Serializes lets as JSON text, compact or indented. Containers are
+	 * walked in place and the text is gathered in a fixed buffer that is handed
+	 * to the sink in chunks, so writing never copies nor allocates by itself
+	 * @tparam Sink type with a write(const char* data, size_t length) method
+	 */
+	template <typename Sink>
+	class Writer
 	{
-		idx++;
-		if (Buffer[idx] == '*')
+	public:
+		/**
+		 * @param _sink Destination of the text, must outlive the writer
+		 * @param _indent Spaces per nesting level, negative for compact output
+		 */
+		Writer(Sink& _sink, int _indent = -1) : sink(_sink), indent(_indent), used(0) {}
+		~Writer() { flush(); }
+		/** write()
+		 * @brief Writes a value and everything it contains
+		 * @param value Value to be written
+		 */
+		void write(const let& value) { writeValue(value, 0); }
+		// Hands the buffered text to the sink
+		void flush()
 		{
-			idx++;
-			while (Buffer[idx] != '*' || Buffer[idx + 1] != '/')
-			{
-				idx++;
-				if (idx >= size)
-					return fileIsValid = false;
-				if (Buffer[idx] == '\n')
-					actualChar = idx;
-			}
-			idx++;
-			return true;
+			if (used)
+				sink.write(buffer, used), used = 0;
 		}
-		else if (Buffer[idx] == '/')
+
+	private:
+		Writer(const Writer&) = delete;
+		Writer& operator=(const Writer&) = delete;
+		// Makes room for n characters in the buffer
+		void reserve(size_t n)
 		{
-			idx++;
-			while (Buffer[idx] != '\n')
+			if (used + n > sizeof(buffer))
+				flush();
+		}
+		void put(char c)
+		{
+			reserve(1);
+			buffer[used++] = c;
+		}
+		void put(const char* data, size_t length)
+		{
+			reserve(length);
+			if (length > sizeof(buffer))
+				sink.write(data, length);
+			else
+				memcpy(buffer + used, data, length), used += length;
+		}
+		// Starts a new line at the given depth, nothing in compact mode
+		void newLine(int depth)
+		{
+			if (indent < 0)
+				return;
+			put('\n');
+			for (size_t spaces = (size_t)indent * depth; spaces;)
 			{
-				idx++;
-				if (idx >= size)
-					return fileIsValid = false;
+				size_t n = spaces < 64 ? spaces : 64;
+				reserve(n);
+				memset(buffer + used, ' ', n);
+				used += n, spaces -= n;
 			}
-			actualChar = idx;
-			idx++;
-			return true;
 		}
-		fileIsValid = false;
-		return false;
-	}
+		void writeString(const char* str, size_t length);
+		void writeValue(const let& value, int depth);
+		Sink& sink;
+		int indent;
+		size_t used;		// Characters of the buffer waiting for the sink
+		char buffer[4096];
+	};
 
-	inline void JSON::ParseString()
+	template <typename Sink>
+	void Writer<Sink>::writeString(const char* str, size_t length)
 	{
-		lastValue = strValue;
-		strValue = "";
-		idx++;
-		if (Buffer[idx] == '\"')
-			return;
-		while (Buffer[idx] != '\"')
+		static const char hex[] = "0123456789abcdef";
+		put('"');
+		size_t start = 0; // First character not written yet
+		for (size_t i = 0; i < length; i++)
 		{
-			strValue += Buffer[idx];
-			if (Buffer[idx] == '\\' && Buffer[idx + 1] == '\"')
-				idx++;
-			idx++;
+			unsigned char c = (unsigned char)str[i];
+			if (c >= 0x20 && c != '"' && c != '\\')
+				continue;
+			put(str + start, i - start);
+			start = i + 1;
+			switch (c)
+			{
+			case '"':
+				put("\\\"", 2);
+				break;
+			case '\\':
+				put("\\\\", 2);
+				break;
+			case '\b':
+				put("\\b", 2);
+				break;
+			case '\f':
+				put("\\f", 2);
+				break;
+			case '\n':
+				put("\\n", 2);
+				break;
+			case '\r':
+				put("\\r", 2);
+				break;
+			case '\t':
+				put("\\t", 2);
+				break;
+			default:
+			{
+				const char escape[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 15] };
+				put(escape, 6);
+			}
+			}
 		}
+		put(str + start, length - start);
+		put('"');
 	}
 
-	inline int JSON::ParseBoolean()
+	template <typename Sink>
+	void Writer<Sink>::writeValue(const let& value, int depth)
 	{
-		switch (Buffer[idx])
+		value.materialize();
+		switch (value.idx)
 		{
-		case 't':
-			idx++;
-			if (idx > size - 1)
-				return error;
-			if (Buffer[idx] != 'r')
-				return error;
-			idx++;
-			if (idx > size - 1)
-				return error;
-			if (Buffer[idx] != 'u')
-				return error;
-			idx++;
-			if (idx > size - 1)
-				return error;
+		case 0:
+			writeString(value._str, value._len);
+			break;
+		case 1:
+			value._bool ? put("true", 4) : put("false", 5);
+			break;
+		case 2:
+			reserve(32);
+			used = i64toa(buffer + used, value._int) - buffer;
+			break;
+		case 3:
+			reserve(32);
+			used = dtoa(buffer + used, value._float) - buffer;
+			break;
+		case 4:
+			reserve(32);
+			used = dtoa(buffer + used, value._double) - buffer;
+			break;
+		case 5:
+		{
+			const Array& elements = *value._array;
+			put('[');
+			for (size_t i = 0; i < elements.size(); i++)
+			{
+				if (i)
+					put(',');
+				newLine(depth + 1);
+				writeValue(elements[i], depth + 1);
+			}
+			if (!elements.empty())
+				newLine(depth);
+			put(']');
+			break;
+		}
+		case 6:
+		{
+			const Map<Key, let>& members = value._obj->values;
+			put('{');
+			for (size_t i = 0; i < members.Size(); i++)
+			{
+				if (i)
+					put(',');
+				newLine(depth + 1);
+				Key key = members.getId(i);
+				writeString(key.str, key.len);
+				indent < 0 ? put(':') : put(": ", 2);
+				writeValue(members[i], depth + 1);
+			}
+			if (!members.isEmpty())
+				newLine(depth);
+			put('}');
+			break;
+		}
+		default:
+			put("null", 4);
+			break;
+		}
+	}
+
+	/** dump()
+	 * @brief Writes a value as JSON text into a sink
+	 * @param value Value to be written
+	 * @param sink Any type with a write(const char* data, size_t length) method
+	 * @param indent Spaces per nesting level, negative for compact output
+	 */
+	template <typename Sink>
+	inline void dump(const let& value, Sink& sink, int indent = -1)
+	{
+		Writer<Sink> writer(sink, indent);
+		writer.write(value);
+	}
+
+	/** dump()
+	 * @brief Appends a value as JSON text to a String. Clearing the String
+	 * between calls reuses its capacity
+	 * @param value Value to be written
+	 * @param out String that receives the text
+	 * @param indent Spaces per nesting level, negative for compact output
+	 */
+	inline void dump(const let& value, String& out, int indent = -1)
+	{
+		StringSink sink(out);
+		dump(value, sink, indent);
+	}
+
+	/** dump()
+	 * @brief Writes a value as JSON text to a stream
+	 * @param value Value to be written
+	 * @param os Stream that receives the text
+	 * @param indent Spaces per nesting level, negative for compact output
+	 */
+	inline void dump(const let& value, std::ostream& os, int indent = -1)
+	{
+		StreamSink sink(os);
+		dump(value, sink, indent);
+	}
+
+	/** stringify()
+	 * @brief Gets a value as JSON text, like JavaScript JSON.stringify
+	 * @param value Value to be written
+	 * @param indent Spaces per nesting level, negative for compact output
+	 * @return The JSON text
+	 */
+	inline String stringify(const let& value, int indent = -1)
+	{
+		String out;
+		dump(value, out, indent);
+		return out;
+	}
+
+	inline String tolow(String value)
+	{
+		for (auto& i : value)
+			i = tolower(i);
+		return value;
+	}
+
+	inline String toup(String value)
+	{
+		for (auto& i : value)
+			i = toupper(i);
+		return value;
+	}
+
+	inline bool JSON::parseComments()
+	{
+		idx++;
+		if (Buffer[idx] == '*')
+		{
+			for (idx++; Buffer[idx] != '*' || Buffer[idx + 1] != '/'; idx++)
+			{
+				if (idx >= size - 3) // Buffer[size - 2] is the NUL terminator
+				{
+					idx = size;
+					return fileIsValid = false;
+				}
+				if (Buffer[idx] == '\n')
+					errorLine++, actualChar = idx;
+			}
+			idx++;
+			return true;
+		}
+		else if (Buffer[idx] == '/')
+		{
+			// The newline or the end of the text is left to the caller
+			while (idx < size - 3 && Buffer[idx + 1] != '\n')
+				idx++;
+			return true;
+		}
+		fileIsValid = false;
+		return false;
+	}
+
+	// True for the whitespace characters of JSON
+	inline bool isSpace(char c)
+	{
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+	}
+
+	/** unescape()
+	 * @brief Character represented by a two characters escape sequence
+	 * @param c Character that follows the backslash
+	 * @return Decoded character, or 0 for \\u and invalid sequences
+	 */
+	inline char unescape(char c)
+	{
+		switch (c)
+		{
+		case '\"':
+		case '\\':
+		case '/':
+			return c;
+		case 'b':
+			return '\b';
+		case 'f':
+			return '\f';
+		case 'n':
+			return '\n';
+		case 'r':
+			return '\r';
+		case 't':
+			return '\t';
+		default:
+			return 0;
+		}
+	}
+
+	/** hexQuad()
+	 * @brief Reads the four hexadecimal digits of a \\u escape
+	 * @param p First digit, the text must be readable up to a NUL or four digits
+	 * @return Code unit, or -1 if a digit is invalid
+	 */
+	inline long hexQuad(const char* p)
+	{
+		long value = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			char c = p[i];
+			int digit = c >= '0' && c <= '9' ? c - '0' : (c | 0x20) >= 'a' && (c | 0x20) <= 'f' ? (c | 0x20) - 'a' + 10 : -1;
+			if (digit < 0)
+				return -1;
+			value = value << 4 | digit;
+		}
+		return value;
+	}
+
+	/** encodeUtf8()
+	 * @brief Writes a code point as UTF-8
+	 * @param out Destination, at least 4 characters
+	 * @param code Code point up to 0x10FFFF
+	 * @return Characters written
+	 */
+	inline int encodeUtf8(char* out, unsigned long code)
+	{
+		if (code < 0x80)
+			return out[0] = (char)code, 1;
+		if (code < 0x800)
+			return out[0] = (char)(0xC0 | code >> 6), out[1] = (char)(0x80 | (code & 0x3F)), 2;
+		if (code < 0x10000)
+		{
+			out[0] = (char)(0xE0 | code >> 12), out[1] = (char)(0x80 | (code >> 6 & 0x3F));
+			out[2] = (char)(0x80 | (code & 0x3F));
+			return 3;
+		}
+		out[0] = (char)(0xF0 | code >> 18), out[1] = (char)(0x80 | (code >> 12 & 0x3F));
+		out[2] = (char)(0x80 | (code >> 6 & 0x3F)), out[3] = (char)(0x80 | (code & 0x3F));
+		return 4;
+	}
+
+	/** decodeEscape()
+	 * @brief Decodes one escape sequence, joining \\u surrogate pairs
+	 * @param p Backslash that starts the sequence, the text must be NUL terminated
+	 * @param out Receives the UTF-8 characters, at least 4
+	 * @param length Receives the number of characters written
+	 * @return Character after the sequence, or nullptr if it is invalid
+	 */
+	inline const char* decodeEscape(const char* p, char* out, int& length)
+	{
+		if (char c = unescape(p[1]))
+			return out[0] = c, length = 1, p + 2;
+		if (p[1] != 'u')
+			return nullptr;
+		long code = hexQuad(p + 2);
+		if (code < 0 || (code >= 0xDC00 && code <= 0xDFFF))
+			return nullptr;
+		p += 6;
+		if (code >= 0xD800 && code <= 0xDBFF)
+		{
+			// High surrogate, a low one must follow
+			long low = p[0] == '\\' && p[1] == 'u' ? hexQuad(p + 2) : -1;
+			if (low < 0xDC00 || low > 0xDFFF)
+				return nullptr;
+			code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+			p += 6;
+		}
+		length = encodeUtf8(out, (unsigned long)code);
+		return p;
+	}
+
+	inline void JSON::ParseString()
+	{
+		char* start = Buffer + idx + 1;
+		const char* end = Buffer + size - 2; // Buffer[size - 2] is the NUL terminator
+		char* p = (char*)findQuoteOrBackslash(start, end);
+		if (p < end && *p == '\"')
+		{
+			// No escapes: the string is a view of the buffer
+			strPtr = start, strLen = p - start;
+			if (flags & parseInSitu)
+				*p = '\0';
+			idx = p - Buffer;
+			return;
+		}
+		// Escaped strings are decoded over themselves in situ, decoding never
+		// grows the text, or into strValue. Plain runs are copied whole
+		bool inSitu = flags & parseInSitu;
+		char* out = p;
+		if (!inSitu)
+			strValue.assign(start, p - start);
+		while (p < end && *p == '\\')
+		{
+			char decoded[4];
+			int length = 0;
+			const char* next = decodeEscape(p, decoded, length);
+			if (!next)
+			{
+				idx = p - Buffer; // Left on the backslash of the invalid sequence
+				strPtr = start, strLen = 0;
+				fileIsValid = false;
+				return;
+			}
+			char* run = (char*)next;
+			p = (char*)findQuoteOrBackslash(run, end);
+			if (inSitu)
+			{
+				memcpy(out, decoded, length);
+				memmove(out + length, run, p - run);
+				out += length + (p - run);
+			}
+			else
+				strValue.append(decoded, length).append(run, p - run);
+		}
+		if (p >= end)
+		{
+			idx = end - Buffer;
+			strPtr = start, strLen = 0;
+			fileIsValid = false;
+			return;
+		}
+		idx = p - Buffer;
+		if (inSitu)
+			*out = '\0', strPtr = start, strLen = out - start;
+		else
+			strPtr = strValue.data(), strLen = strValue.size();
+	}
+
+	inline int JSON::ParseBoolean()
+	{
+		switch (Buffer[idx])
+		{
+		case 't':
+			idx++;
+			if (idx > size - 1)
+				return error;
+			if (Buffer[idx] != 'r')
+				return error;
+			idx++;
+			if (idx > size - 1)
+				return error;
+			if (Buffer[idx] != 'u')
+				return error;
+			idx++;
+			if (idx > size - 1)
+				return error;
 			if (Buffer[idx] != 'e')
 				return error;
 			return 1;
@@ -676,130 +2714,72 @@ namespace json
 
 	inline bool JSON::ParseNumber()
 	{
-		lastValue = numValue;
-		numValue = "";
-		bool keep = true, isInt = true;
-		int num_dots = 0, num_minus = 0, num_nums = 0;
-		std::string out = "";
-		do
+		// Exact powers of ten for the Clinger fast path
+		static const double exact[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+										1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+		const char* start = Buffer + idx;
+		const char* p = start;
+		bool negative = *p == '-', isInt = true;
+		if (negative)
+			p++;
+		if (*p < '0' || *p > '9')
+			return fileIsValid = false;
+		// Significand digits accumulate in a 64 bits integer, at most 19 of them are exact
+		unsigned long long w = 0;
+		long long exponent = 0;
+		int digits = 0;
+		if (*p == '0')
 		{
-			if (idx >= size)
-				break;
-			switch (Buffer[idx])
-			{
-			case 'e':
-			case 'E':
-				if (Buffer[idx - 1] == '-' || Buffer[idx - 1] == '+')
-				{
-					fileIsValid = false;
-					return isInt;
-				}
-				isInt = false;
-				numValue += 'e';
-				num_nums++;
-				break;
-			case '0':
-				numValue += '0';
-				num_nums++;
-				break;
-			case '1':
-				numValue += '1';
-				num_nums++;
-				break;
-			case '2':
-				numValue += '2';
-				num_nums++;
-				break;
-			case '3':
-				numValue += '3';
-				num_nums++;
-				break;
-			case '4':
-				numValue += '4';
-				num_nums++;
-				break;
-			case '5':
-				numValue += '5';
-				num_nums++;
-				break;
-			case '6':
-				numValue += '6';
-				num_nums++;
-				break;
-			case '7':
-				numValue += '7';
-				num_nums++;
-				break;
-			case '8':
-				numValue += '8';
-				num_nums++;
-				break;
-			case '9':
-				numValue += '9';
-				num_nums++;
-				break;
-			case '.':
-				if (num_dots >= 1)
-				{
-					fileIsValid = false;
-					return isInt;
-				}
-				numValue += '.';
-				isInt = false;
-				num_dots++;
-				break;
-			case '+':
-				if (Buffer[idx - 1] == 'e' || Buffer[idx - 1] == 'E')
-				{
-					numValue += '+';
-					break;
-				}
-				fileIsValid = false;
-				return isInt;
-			case '-':
-				if (Buffer[idx - 1] == '0' ||
-					Buffer[idx - 1] == '1' ||
-					Buffer[idx - 1] == '2' ||
-					Buffer[idx - 1] == '3' ||
-					Buffer[idx - 1] == '4' ||
-					Buffer[idx - 1] == '5' ||
-					Buffer[idx - 1] == '6' ||
-					Buffer[idx - 1] == '7' ||
-					Buffer[idx - 1] == '8' ||
-					Buffer[idx - 1] == '9')
-				{
-					fileIsValid = false;
-					return isInt;
-				}
-				if (num_minus == 1)
-				{
-					if (Buffer[idx - 1] != 'e' && Buffer[idx - 1] != 'E')
-					{
-						fileIsValid = false;
-						return isInt;
-					}
-				}
-				else if (num_minus > 1)
-				{
-					fileIsValid = false;
-					return isInt;
-				}
-				numValue += '-';
-				num_minus++;
-				break;
-			default:
-				if ((num_minus > 0 && num_nums <= 0) || Buffer[idx - 1] == '+' || Buffer[idx - 1] == 'e' || Buffer[idx - 1] == 'E')
-				{
-					fileIsValid = false;
-					return isInt;
-				}
-				keep = false;
-				break;
-			}
-			idx++;
-		} while (keep);
-		idx -= 2;
-		return isInt;
+			p++;
+			if (*p >= '0' && *p <= '9')
+				return fileIsValid = false;
+		}
+		else
+			for (; *p >= '0' && *p <= '9'; p++, digits++)
+				w = 10 * w + (unsigned long long)(*p - '0');
+		if (*p == '.')
+		{
+			isInt = false;
+			const char* fraction = ++p;
+			for (; *p >= '0' && *p <= '9'; p++)
+				if (digits || *p != '0') // Leading zeros of 0.000x are not significant
+					w = 10 * w + (unsigned long long)(*p - '0'), digits++;
+			if (p == fraction)
+				return fileIsValid = false;
+			exponent -= p - fraction;
+		}
+		if (*p == 'e' || *p == 'E')
+		{
+			isInt = false;
+			p++;
+			bool negativeExponent = *p == '-';
+			if (*p == '-' || *p == '+')
+				p++;
+			if (*p < '0' || *p > '9')
+				return fileIsValid = false;
+			long long e = 0;
+			for (; *p >= '0' && *p <= '9'; p++)
+				if (e < 100000)
+					e = 10 * e + (*p - '0');
+			exponent += negativeExponent ? -e : e;
+		}
+		idx = (long int)(p - Buffer) - 1;
+		if (isInt && digits <= 19 && (w <= 9223372036854775807ULL || (negative && w == 9223372036854775808ULL)))
+		{
+			numInt = negative ? (long long)(0 - w) : (long long)w;
+			return true;
+		}
+		double value;
+		if (digits > 19)
+			return numDouble = strtod(start, nullptr), false;
+		if (w == 0)
+			value = 0;
+		else if (w <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+			value = exponent < 0 ? (double)w / exact[-exponent] : (double)w * exact[exponent];
+		else if (!eiselLemire(w, exponent, value))
+			return numDouble = strtod(start, nullptr), false;
+		numDouble = negative ? -value : value;
+		return false;
 	}
 
 	inline bool JSON::ParseNull()
@@ -826,89 +2806,205 @@ namespace json
 		return false;
 	}
 
-	inline let JSON::Parse(char* _string)
+	inline void JSON::begin(unsigned _flags, bool keep)
 	{
 		strValue = "";
-		lastValue = "";
-		numValue = "";
+		flags = _flags;
+		if (!keep)
+			keys.clear(), strings.reset();
+		recycle(content);
+		lazyText.reset();
+		key = nullptr;
+		objLevels.clear();
+		levelKeys.clear();
+		arrayLevel.clear();
+		lastOperation = jsonOperations::none;
 		fileIsValid = true;
+		stopped = false;
+		errorDescription = "This is a valid JSON";
+		expectedValues = { "none" };
+		streaming = false;
+		streamed = 0;
 		actualH = ' ';
 		errorLine = 1, actualChar = 0, keyLevels = 0, levels = 0, limit = 0, actualParam = 0, idx = -1;
-		std::vector<Array> ArrayLevels = {};
-		std::vector<let> objLevels = {};
+	}
 
-		if (_string != 0)
-			Buffer = _string;
-		if (size == 0)
-			size = strlen(Buffer) + 2;
-		auto Log = [&]() {
-			std::string val = "";
-			switch (Buffer[idx])
-			{
-			case '\n':
-				val = "Line end: \\n";
-				break;
-			case '\r':
-				val = "\\r";
-				break;
-			case '\t':
-				val = "Tabular: \\t";
-				break;
-			case EOF:
-			case 0x03:
-				val = "End of file";
-				break;
-			case '\0':
-				val = "Null character";
-				break;
-			default:
-				val = Buffer[idx];
-				break;
-			}
-			errorPos = idx - actualChar;
-			errorDescription = "Error at line " + std::to_string(errorLine) + ", in character -> '" + val + "' in position: " + std::to_string(errorPos) + '\n';
-		};
+	inline void JSON::locate(long int from)
+	{
+		for (long int i = from; i < idx && i < size - 2; i++)
+			if (Buffer[i] == '\n')
+				errorLine++, actualChar = i;
+	}
 
-		do
+	inline void JSON::Log()
+	{
+		if (idx > size - 2)
+			idx = size - 2; // Errors found after the end point at the NUL terminator
+		if (indexed)
 		{
-			idx++;
-			switch (Buffer[idx])
-			{
-			case '\"':
-			{
-				switch (actualH)
-				{
-				case ',':
-					ParseString();
-					if (arrayLevel.size() > 0)
-						if (arrayLevel.back() == 0 && ArrayLevels.size() > 0)
-							ArrayLevels.back().push_back(strValue.c_str());
-					break;
-				case '{':
-					ParseString();
-					break;
-				case '[':
-					ParseString();
-					if (ArrayLevels.size() > 0)
-						ArrayLevels.back().push_back(strValue.c_str());
-					break;
-				case ':':
-					ParseString();
-					if (objLevels.size() > 0)
-						objLevels.back()[lastValue] = strValue.c_str();
-					break;
-				case '}':
-				case ']':
-				case '\"':
-					Log();
+			// Newlines are not visited when walking the index
+			errorLine = 1, actualChar = 0;
+			locate(0);
+		}
+		std::string val = "";
+		switch (Buffer[idx])
+		{
+		case '\n':
+			val = "Line end: \\n";
+			break;
+		case '\r':
+			val = "\\r";
+			break;
+		case '\t':
+			val = "Tabular: \\t";
+			break;
+		case EOF:
+		case 0x03:
+			val = "End of file";
+			break;
+		case '\0':
+			val = "Null character";
+			break;
+		default:
+			val = Buffer[idx];
+			break;
+		}
+		errorPos = idx - actualChar;
+		errorDescription = "Error at line " + std::to_string(errorLine) + ", in character -> '" + val + "' in position: " + std::to_string(errorPos) + '\n';
+	}
+
+	inline bool JSON::utf8Error(long int offset)
+	{
+		long int from = idx + 1;
+		idx = offset;
+		locate(from);
+		errorPos = idx - actualChar;
+		errorDescription = "Error at line " + std::to_string(errorLine) + ", invalid UTF-8 sequence at byte offset " + std::to_string(idx + streamed) + " in position: " + std::to_string(errorPos) + '\n';
+		expectedValues = { "UTF-8" };
+		return fileIsValid = false;
+	}
+
+	inline bool JSON::tokenComplete()
+	{
+		const char* end = Buffer + size - 2;
+		const char* p = Buffer + idx;
+		// Long strings and comments are scanned once, from where the previous chunk stopped
+		const char* from = Buffer + (scanned > idx ? scanned : idx + 1);
+		switch (*p)
+		{
+		case '\"':
+		{
+			const char* q = from;
+			while ((q = findQuoteOrBackslash(q, end)) < end && *q == '\\')
+				q += 2;
+			if (q < end)
+				return scanned = 0, true;
+			scanned = (long int)(q > end ? q - 2 - Buffer : end - Buffer); // Stops on a backslash cut from its character
+			return false;
+		}
+		case '/':
+			if (p + 1 >= end)
+				return false;
+			if (p[1] == '/')
+			{
+				if (from < p + 2)
+					from = p + 2;
+				if (memchr(from, '\n', end - from))
+					return scanned = 0, true;
+			}
+			else if (p[1] == '*')
+			{
+				if (from < p + 2)
+					from = p + 2;
+				for (; from + 1 < end; from++)
+					if (from[0] == '*' && from[1] == '/')
+						return scanned = 0, true;
+			}
+			else
+				return true;
+			scanned = (long int)(from - Buffer);
+			return false;
+		case 't':
+		case 'n':
+			return end - p >= 4;
+		case 'f':
+			return end - p >= 5;
+		case '-':
+		case '0':
+		case '1':
+		case '2':
+		case '3':
+		case '4':
+		case '5':
+		case '6':
+		case '7':
+		case '8':
+		case '9':
+			for (p++; p < end; p++)
+				if ((*p < '0' || *p > '9') && *p != '.' && *p != 'e' && *p != 'E' && *p != '+' && *p != '-')
+					return true;
+			return false;
+		default:
+			return true;
+		}
+	}
+
+	template <typename Handler>
+	inline bool JSON::parseTokens(bool last, Handler& handler)
+	{
+		do
+		{
+			// A character right after a number or literal is not in the index but
+			// must be checked; anything else than whitespace there is an error
+			if (!indexed)
+				idx++;
+			else if (structurals[cursor] != (unsigned)(idx + 1) && idx >= 0 && !isSpace(Buffer[idx + 1]))
+				idx++;
+			else
+				idx = structurals[cursor++];
+			// While streaming, stop at the end of the text or before a token the
+			// next chunk may continue
+			if (!last && (idx >= size - 2 || !tokenComplete()))
+			{
+				idx--;
+				return true;
+			}
+			switch (Buffer[idx])
+			{
+			case '\"':
+			{
+				switch (actualH)
+				{
+				case '}':
+				case ']':
+				case '\"':
+					Log();
 					errorDescription += "Expected -> ',' , ':' , '}' , ']'\n";
 					expectedValues = { ",", ":", "}", "]" };
 					return fileIsValid = false;
 				default:
-					ParseString();
 					break;
 				}
+				// Strings after '{', or after ',' anywhere but right in an array, are keys
+				bool isKey = actualH == '{' || (actualH == ',' && (arrayLevel.empty() || arrayLevel.back() != 0));
+				ParseString();
+				if (!fileIsValid && Buffer[idx] == '\\')
+				{
+					Log();
+					errorDescription += "Invalid escape sequence. Expected -> '\\\"' , '\\\\' , '/' , 'b' , 'f' , 'n' , 'r' , 't' , 'uXXXX'\n";
+					expectedValues = { "\\\"", "\\\\", "/", "b", "f", "n", "r", "t", "uXXXX" };
+					return fileIsValid = false;
+				}
+				if (!fileIsValid)
+				{
+					Log();
+					errorDescription += "String has no end statement. Expected -> '\"'\n";
+					expectedValues = { "\"" };
+					return fileIsValid = false;
+				}
 				actualH = '\"';
+				if (!(isKey ? handler.onKey(strPtr, strLen) : handler.onString(strPtr, strLen)))
+					return stop();
 				break;
 			}
 			case '{':
@@ -916,22 +3012,9 @@ namespace json
 				if (arrayLevel.size() > 0)
 					if (arrayLevel.back() >= 0)
 						arrayLevel.back()++;
-				if (content.getType() == Type::None)
-				{
-					content = obj();
-					objLevels.push_back(content);
-				}
 				lastOperation = jsonOperations::objOpen;
 				switch (actualH)
 				{
-				case ':':
-					objLevels.back()[strValue] = obj();
-					//objLevels.push_back(objLevels.back()[strValue]);
-					break;
-				case ',':
-				case '[':
-					objLevels.push_back(obj());
-					break;
 				case '{':
 				case '}':
 				case ']':
@@ -945,7 +3028,8 @@ namespace json
 				default:
 					break;
 				}
-
+				if (!handler.onObjectStart())
+					return stop();
 				actualH = '{';
 				keyLevels++;
 				break;
@@ -980,6 +3064,8 @@ namespace json
 				default:
 					break;
 				}
+				if (!handler.onObjectEnd())
+					return stop();
 				actualH = '}';
 				keyLevels--;
 				break;
@@ -987,11 +3073,6 @@ namespace json
 			case '[':
 			{
 				arrayLevel.push_back(0);
-				if (content.getType() == Type::None)
-				{
-					content = Array();
-					objLevels.push_back(content);
-				}
 				lastOperation = jsonOperations::arrayOpen;
 				switch (actualH)
 				{
@@ -1010,6 +3091,8 @@ namespace json
 				default:
 					break;
 				}
+				if (!handler.onArrayStart())
+					return stop();
 				actualH = '[';
 				levels++;
 				break;
@@ -1043,6 +3126,8 @@ namespace json
 				default:
 					break;
 				}
+				if (!handler.onArrayEnd())
+					return stop();
 				actualH = ']';
 				levels--;
 				break;
@@ -1122,8 +3207,12 @@ namespace json
 				switch (ParseBoolean())
 				{
 				case 0:
+					if (!handler.onBool(false))
+						return stop();
 					break;
 				case 1:
+					if (!handler.onBool(true))
+						return stop();
 					break;
 				default:
 					Log();
@@ -1161,6 +3250,8 @@ namespace json
 					expectedValues = { "null", ",", ":", "}", "]" };
 					return fileIsValid = false;
 				}
+				if (!handler.onNull())
+					return stop();
 				break;
 			}
 			case '0':
@@ -1193,7 +3284,7 @@ namespace json
 					break;
 				}
 				actualH = '\"';
-				ParseNumber();
+				bool isInt = ParseNumber();
 				if (!fileIsValid)
 				{
 					Log();
@@ -1201,6 +3292,8 @@ namespace json
 					expectedValues = { ",", "}", "]", "Number" };
 					return fileIsValid = false;
 				}
+				if (!(isInt ? handler.onNumber(numInt) : handler.onNumber(numDouble)))
+					return stop();
 				break;
 			}
 			case '\n':
@@ -1217,6 +3310,12 @@ namespace json
 				break;
 			case EOF:
 			case '\0':
+				if (idx < size - 2)
+				{
+					Log();
+					errorDescription += "Invalid character\n";
+					return fileIsValid = false;
+				}
 				idx = size;
 				break;
 			case '/':
@@ -1243,10 +3342,11 @@ namespace json
 			}
 
 		} while (idx < size - 1);
+		return true;
+	}
 
-		delete[] Buffer;
-		if (_string != 0)
-			delete[] _string;
+	inline void JSON::closeDocument()
+	{
 		arrayLevel.clear();
 		fileIsValid = levels == 0 && keyLevels == 0 ? true : false;
 		if (keyLevels > 0)
@@ -1274,9 +3374,1322 @@ namespace json
 			errorDescription += "Missing " + std::to_string(levels) + " '['\n";
 			expectedValues = { "[" };
 		}
+	}
+
+	inline bool JSON::indexBuffer()
+	{
+		// Stage 1: the structural index lets the loop below jump over whitespace and
+		// string contents. Texts it does not cover are parsed character by character
+		// With parseValidateUtf8 the index also checks the text as UTF-8
+		cursor = 0;
+		size_t invalidUtf8 = (size_t)(size - 2);
+		indexed = !(flags & parseNoIndex) && (unsigned long long)size < 0xffffffffULL &&
+				  buildStructuralIndex(Buffer, size - 2, structurals, flags & parseValidateUtf8 ? &invalidUtf8 : nullptr);
+		if (!indexed && (flags & parseValidateUtf8))
+			invalidUtf8 = validateUtf8(Buffer, size - 2);
+		if (invalidUtf8 < (size_t)(size - 2))
+			return utf8Error((long int)invalidUtf8);
+		return true;
+	}
+
+	inline let& JSON::Parse(char* _string, unsigned _flags)
+	{
+		begin(_flags);
+		if (_string != 0)
+			Buffer = _string;
+		if (size == 0)
+			size = strlen(Buffer) + 2;
+		bool parsed = parseBuffer();
+		size = 0; // Only parseFile() knows the length of the next text
+		// Lazy documents keep the text, see lazyRoot()
+		if (!lazyText && !(flags & parseInSitu) && ownsBuffer)
+			delete[] Buffer;
+		if (!parsed || !fileIsValid)
+			fileIsValid = false, recycle(content);
 		return content;
 	}
 
+	inline let& JSON::parseText(const char* text, unsigned _flags)
+	{
+		begin(_flags & ~parseInSitu);
+		Buffer = (char*)text; // Only written when parsing in situ
+		size = (long int)strlen(text) + 2;
+		ownsBuffer = false;
+		if (!parseBuffer() || !fileIsValid)
+			recycle(content);
+		ownsBuffer = true;
+		size = 0;
+		return content;
+	}
+
+	inline bool JSON::parseBuffer()
+	{
+		if (!indexBuffer())
+			return fileIsValid = false;
+		// Lazy and projected documents need the index, texts with comments are
+		// parsed whole (and pruned)
+		bool container = indexed && (Buffer[structurals[0]] == '{' || Buffer[structurals[0]] == '[');
+		bool projecting = !projection.empty() && !projection[0].whole;
+		if (projecting && container)
+			return projectRoot();
+		if ((flags & parseLazy) && container)
+			return lazyRoot();
+		if ((flags & parseParallel) && indexed && parseSplit())
+			return true;
+		Builder builder = { *this };
+		if (!parseTokens(true, builder))
+			return fileIsValid = false;
+		closeDocument();
+		if (projecting && fileIsValid)
+			prune(content, projection[0]);
+		return true;
+	}
+
+	template <typename Handler>
+	inline bool JSON::parseEvents(const char* text, Handler& handler, unsigned _flags)
+	{
+		begin(_flags & ~(parseInSitu | parseLazy));
+		Buffer = (char*)text; // Only written when parsing in situ
+		size = (long int)strlen(text) + 2;
+		bool valid = indexBuffer() && parseTokens(true, handler);
+		if (valid)
+			closeDocument();
+		size = 0;
+		return valid && fileIsValid;
+	}
+
+	inline bool JSON::parseRecord(const char* text, size_t length, unsigned _flags, bool keep)
+	{
+		begin(_flags & ~(parseInSitu | parseLazy), keep);
+		// The parser stops at a NUL, the record is followed by the next one
+		pending.assign(text, length);
+		return parsePending();
+	}
+
+	inline bool JSON::parsePending()
+	{
+		Buffer = &pending[0];
+		size = (long int)pending.size() + 2;
+		Builder builder = { *this };
+		if (indexBuffer() && parseTokens(true, builder))
+			closeDocument();
+		size = 0;
+		return fileIsValid;
+	}
+
+	inline bool JSON::feed(const char* data, size_t length, unsigned _flags)
+	{
+		if (!streaming)
+		{
+			begin(_flags & ~(parseInSitu | parseLazy)); // Strings are copied out of the chunks
+			pending.clear();
+			validated = 0, scanned = 0;
+			indexed = false;
+			streaming = true;
+		}
+		if (!fileIsValid)
+			return false;
+		pending.append(data, length);
+		return parseChunk(false);
+	}
+
+	inline let& JSON::finish()
+	{
+		if (!streaming)
+			feed("", 0);
+		if (fileIsValid && parseChunk(true))
+			closeDocument();
+		streaming = false;
+		pending.clear();
+		size = 0;
+		if (!fileIsValid)
+			recycle(content);
+		return content;
+	}
+
+	inline bool JSON::parseChunk(bool last)
+	{
+		Buffer = &pending[0];
+		size = (long int)pending.size() + 2;
+		if (flags & parseValidateUtf8)
+		{
+			// A sequence cut at the end of the chunk is checked with the next one
+			bool truncated = false;
+			size_t invalid = validated + validateUtf8(Buffer + validated, pending.size() - validated, last ? nullptr : &truncated);
+			if (invalid < pending.size() && !truncated)
+				return utf8Error((long int)invalid);
+			validated = invalid;
+		}
+		Builder builder = { *this };
+		if (!parseTokens(last, builder) || last)
+			return fileIsValid;
+		// Parsed text is dropped, only the unfinished token is kept
+		size_t parsed = (size_t)(idx + 1);
+		pending.erase(0, parsed);
+		streamed += parsed, validated -= parsed;
+		actualChar -= (int)parsed;
+		scanned = scanned ? scanned - (long int)parsed : 0;
+		idx = -1;
+		return true;
+	}
+
+	inline let& JSON::parseFile(const char* filePath, unsigned _flags)
+	{
+		filename = filePath;
+		// The length is known, so Parse() does not have to look for the NUL
+		bool opened = file.open(filePath);
+		if (opened)
+			size = (long int)file.size() + 2, ownsBuffer = false;
+		if (opened)
+			Parse(file.data(), _flags);
+		ownsBuffer = true;
+		size = 0;
+		if (!opened)
+		{
+			recycle(content);
+			fileIsValid = false;
+			errorLine = 0, errorPos = 0;
+			errorDescription = "Cannot open the file " + filename + '\n';
+			expectedValues = { "file" };
+		}
+		else if (!(_flags & (parseInSitu | parseLazy)))
+			file.close();
+		return content;
+	}
+
+	inline bool JSON::lazyRoot()
+	{
+		// The text stays with the handler while lazy values point into it. Strings
+		// are never decoded over it: copies of a lazy value may parse it again
+		if (!(flags & parseInSitu) && ownsBuffer)
+			lazyText.reset(Buffer);
+		flags &= ~parseInSitu;
+		return lazyContent();
+	}
+
+	inline bool JSON::lazyContent()
+	{
+		// Only the brackets are checked until the values are visited
+		size_t end = closingEntry(0), last = structurals.size() - 1;
+		if (end == last || end + 1 != last)
+		{
+			idx = structurals[end == last ? last : end + 1];
+			Log();
+			if (end == last)
+			{
+				errorDescription += "Expected -> '}' , ']'\n";
+				expectedValues = { "}", "]" };
+			}
+			else
+				errorDescription += "Invalid character\n";
+			return fileIsValid = false;
+		}
+		content._lazy = this, content._len = 0, content.idx = 7;
+		content.type = Buffer[structurals[0]] == '{' ? Type::Object : Type::Array;
+		return true;
+	}
+
+	inline bool JSON::projectRoot()
+	{
+		// The kept values are built right away, the text is not needed afterwards
+		if (!lazyContent())
+			return false;
+		parseMembers(content, &projection[0]);
+		return fileIsValid;
+	}
+
+	inline bool JSON::parseSplit()
+	{
+		unsigned count = threads ? threads : std::thread::hardware_concurrency();
+		size_t last = structurals.size() - 1;
+		// Texts under 1 MB are parsed faster than the threads start
+		if (count < 2 || structurals[last] < (1 << 20))
+			return false;
+
+		// Descends into the member that holds most of the text until a container
+		// has enough members and none of them holds half of it
+		std::vector<std::pair<size_t, size_t>> path; // Position of the member descended into, and members of its container
+		std::vector<size_t> commas;					 // Entries of the commas between the members of the container
+		size_t entry = 0, close = 0;
+		for (;;)
+		{
+			char open = Buffer[structurals[entry]];
+			close = closingEntry(entry);
+			if ((open != '{' && open != '[') || close == last)
+				return false;
+			commas.clear();
+			size_t start = entry + 1, biggest = 0, biggestStart = 0, biggestPosition = 0;
+			for (size_t k = entry + 1; k <= close; k++)
+			{
+				char c = Buffer[structurals[k]];
+				if (c == '{' || c == '[')
+					k = closingEntry(k);
+				else if (c == ',' || (k == close && k > entry + 1))
+				{
+					if (structurals[k] - structurals[start] > biggest)
+						biggest = structurals[k] - structurals[start], biggestStart = start, biggestPosition = commas.size();
+					if (c == ',')
+						commas.push_back(k);
+					start = k + 1;
+				}
+			}
+			size_t members = close > entry + 1 ? commas.size() + 1 : 0;
+			if (members >= count && 2 * biggest <= structurals[close] - structurals[entry])
+				break;
+			size_t value = open == '{' ? biggestStart + 2 : biggestStart;
+			if (members == 0 || value >= close || (open == '{' && Buffer[structurals[value - 1]] != ':'))
+				return false;
+			path.push_back(std::make_pair(biggestPosition, members));
+			entry = value;
+		}
+
+		// Slices of members of about the same size, cut at commas
+		char* text = Buffer;
+		long int textSize = size;
+		size_t opening = structurals[entry], closing = structurals[close], from = opening + 1;
+		std::vector<std::pair<size_t, size_t>> slices;
+		for (size_t comma : commas)
+			if ((structurals[comma] - from) * count >= closing - opening)
+				slices.push_back(std::make_pair(from, (size_t)structurals[comma])), from = structurals[comma] + 1;
+		slices.push_back(std::make_pair(from, closing));
+		while (helpers.size() < slices.size())
+			helpers.emplace_back(new JSON);
+
+		// Every slice is parsed as an object or array of its own while this
+		// handler parses the rest of the text, where the container is empty
+		unsigned parsedFlags = flags, sliceFlags = flags & ~(parseInSitu | parseValidateUtf8 | parseParallel);
+		begin(sliceFlags);
+		pending.assign(text, opening + 1).append(text + closing, (size_t)textSize - 2 - closing);
+		bool valid = true;
+		runThreads(slices.size() + 1, [&](size_t i) {
+			if (i == 0)
+				return (void)parsePending();
+			JSON& helper = *helpers[i - 1];
+			helper.begin(sliceFlags);
+			helper.pending.assign(1, text[opening]).append(text + slices[i - 1].first, slices[i - 1].second - slices[i - 1].first);
+			helper.pending += text[closing];
+			helper.parsePending();
+		});
+		flags = parsedFlags, Buffer = text, size = textSize;
+		for (size_t i = 0; i < slices.size(); i++)
+			valid = valid && helpers[i]->fileIsValid;
+
+		// The empty container is found again by the positions of the path
+		let* node = &content;
+		for (size_t step = 0; valid && step < path.size(); step++)
+		{
+			if (node->idx == 6 && node->_obj->values.Size() == path[step].second)
+				node = &node->_obj->values[path[step].first];
+			else if (node->idx == 5 && node->_array->size() == path[step].second)
+				node = &(*node->_array)[path[step].first];
+			else
+				valid = false; // Duplicated keys moved the members
+		}
+		if (!valid || !fileIsValid || node->size() != 0)
+		{
+			// Errors are reported by the parse in one piece, with their positions
+			begin(flags);
+			indexBuffer();
+			return false;
+		}
+		if (node->idx == 5)
+		{
+			size_t total = 0;
+			for (size_t i = 0; i < slices.size(); i++)
+				total += helpers[i]->content._array->size();
+			node->_array->reserve(total);
+			for (size_t i = 0; i < slices.size(); i++)
+				for (let& item : *helpers[i]->content._array)
+					node->_array->emplace_back(std::move(item));
+		}
+		else
+			for (size_t i = 0; i < slices.size(); i++)
+			{
+				Map<Key, let>& members = helpers[i]->content._obj->values;
+				for (size_t m = 0; m < members.Size(); m++)
+					if (let* member = node->_obj->addMember(members.getId(m)))
+						member->take(members[m]);
+			}
+		return true;
+	}
+
+	inline size_t JSON::closingEntry(size_t entry) const
+	{
+		size_t last = structurals.size() - 1, depth = 0;
+		for (; entry < last; entry++)
+		{
+			char c = Buffer[structurals[entry]];
+			if (c == '{' || c == '[')
+				depth++;
+			else if ((c == '}' || c == ']') && --depth == 0)
+				return entry;
+		}
+		return last;
+	}
+
+	inline void JSON::lazyError(size_t entry)
+	{
+		idx = structurals[entry < structurals.size() ? entry : structurals.size() - 1];
+		Log();
+		errorDescription += "Expected -> 'Definition' , 'Value' , ',' , '}' , ']'\n";
+		expectedValues = { "Definition", "Value", ",", "}", "]" };
+		fileIsValid = false;
+	}
+
+	inline void JSON::materialize(let& value)
+	{
+		// Parse() may have run since, the end mark of the index is the length of the text
+		long int parsedSize = size;
+		size = (long int)structurals.back() + 2;
+		parseMembers(value);
+		size = parsedSize;
+	}
+
+	inline void JSON::parseMembers(let& value, const Projection* node)
+	{
+		bool isObject = value.type == Type::Object;
+		char close = isObject ? '}' : ']';
+		size_t open = value._len, k = open + 1;
+		if (isObject)
+			value._obj = new obj(), value.idx = 6;
+		else
+			value._array = new Array(), value.idx = 5;
+		value._len = 0, value.owned = !node; // Projections build their members whole
+		// Character of an entry of the index, past the end mark it is the NUL terminator
+		auto at = [&](size_t entry) { return entry < structurals.size() ? Buffer[structurals[entry]] : '\0'; };
+		if (at(k) == close)
+			return;
+		if (!node)
+		{
+			// Moving a lazy value materializes it, so the vector of the members must
+			// not grow while they are added: the commas outside nested values count them
+			size_t members = 1;
+			closings.clear();
+			for (size_t entry = k; entry < structurals.size() - 1 && at(entry) != close; entry++)
+				if (at(entry) == '{' || at(entry) == '[')
+					entry = closingEntry(entry), closings.push_back(entry);
+				else if (at(entry) == ',')
+					members++;
+			if (isObject)
+				value._obj->values.reserve(members);
+			else
+				value._array->reserve(members);
+		}
+		size_t nested = 0; // Next of closings
+		for (long long position = 0;; k++, position++)
+		{
+			Key name;
+			const Projection* child = nullptr;
+			if (isObject)
+			{
+				if (at(k) != '\"')
+					return lazyError(k);
+				idx = structurals[k];
+				ParseString();
+				if (!fileIsValid || at(k + 1) != ':')
+					return lazyError(k + 1);
+				if (node)
+					child = projected(*node, strPtr, strLen, -1);
+				if (!node || child)
+					name = keys.intern(strPtr, strLen);
+				k += 2;
+			}
+			else if (node)
+			{
+				// Past the last kept element the rest of the array is not visited
+				if (!node->whole && position > node->last)
+				{
+					k = closingEntry(open);
+					if (at(k) != close)
+						return lazyError(k);
+					return;
+				}
+				child = projected(*node, nullptr, 0, position);
+			}
+			if (k >= structurals.size() - 1)
+				return lazyError(k);
+			idx = structurals[k];
+			if (node && !child)
+			{
+				// Skipped values are only jumped over
+				if (at(k) == '{' || at(k) == '[')
+					k = closingEntry(k);
+				if (!isObject)
+					value._array->push_back(nullptr);
+				char next = at(++k);
+				if (next == close)
+					return;
+				if (next != ',')
+					return lazyError(k);
+				continue;
+			}
+			let item;
+			switch (at(k))
+			{
+			case '{':
+			case '[':
+				// Nested values stay lazy, the index skips over them
+				item._lazy = this, item._len = (unsigned)k, item.idx = 7;
+				item.type = at(k) == '{' ? Type::Object : Type::Array;
+				k = node || nested == closings.size() ? closingEntry(k) : closings[nested++];
+				break;
+			case '\"':
+				ParseString();
+				if (!fileIsValid)
+					return lazyError(k);
+				item = stringValue(strPtr, strLen);
+				break;
+			case 't':
+			case 'f':
+			{
+				int boolean = ParseBoolean();
+				if (boolean == error)
+					return lazyError(k);
+				item = boolean == 1;
+				break;
+			}
+			case 'n':
+				if (!ParseNull())
+					return lazyError(k);
+				item = nullptr;
+				break;
+			default:
+			{
+				bool isInt = ParseNumber();
+				if (!fileIsValid)
+					return lazyError(k);
+				if (isInt)
+					item = numInt;
+				else
+					item = numDouble;
+				break;
+			}
+			}
+			// Scalars are not closed by the index, what follows them is checked here
+			char after = Buffer[idx + 1];
+			if (item.idx != 7 && !isSpace(after) && after != ',' && after != close && after != '\0')
+				return lazyError(k);
+			if (child && item.idx == 7)
+			{
+				parseMembers(item, child);
+				if (!fileIsValid)
+					return;
+			}
+			else if (child && !child->whole)
+			{
+				// The paths go on under a string, number or literal: nothing is kept
+				if (isObject)
+					name = nullptr;
+				else
+					item = nullptr;
+			}
+			// Built values are moved, not copied, lazy ones without being materialized
+			if (isObject && name)
+			{
+				if (let* member = value._obj->addMember(name))
+					member->take(item);
+			}
+			else if (!isObject)
+				value._array->emplace_back(), value._array->back().take(item);
+			char next = at(++k);
+			if (next == close)
+				return;
+			if (next != ',')
+				return lazyError(k);
+		}
+	}
+
+	inline void let::materialize() const
+	{
+		if (idx == 7)
+			_lazy->materialize(const_cast<let&>(*this));
+	}
+
+	inline void let::detach()
+	{
+		materialize();
+		if ((idx != 5 && idx != 6) || !owned)
+			return;
+		owned = false;
+		if (idx == 5)
+			for (let& item : *_array)
+				item.detach();
+		else
+			for (size_t i = 0; i < _obj->values.Size(); i++)
+				_obj->values[i].detach();
+	}
+
+	inline Bool JSON::readJSON(String filename)
+	{
+		parseFile(filename.c_str());
+		return fileIsValid;
+	}
+
+	inline void LineReader::split(const char* text, size_t length)
+	{
+		// Ranges of 1 MB at least, smaller ones do not pay for their thread
+		size_t ranges = length / (1 << 20) + 1;
+		if (ranges > threadCount)
+			ranges = threadCount;
+		ends.resize(2 * ranges);
+		std::vector<unsigned char> changes(ranges);
+		BlockClassifier classify = blockClassifier();
+		runThreads(ranges, [&](size_t i) {
+			ends[2 * i].clear(), ends[2 * i + 1].clear();
+			changes[i] = findLineEnds(text, length * i / ranges, length * (i + 1) / ranges, &ends[2 * i], classify);
+		});
+
+		// Only now is it known which ranges start inside a string
+		lines.clear();
+		size_t start = 0;
+		auto addLine = [&](size_t end) {
+			while (start < end && isSpace(text[start]))
+				start++;
+			if (start < end)
+				lines.push_back(std::make_pair(start, end));
+			start = end + 1;
+		};
+		unsigned char inString = 0;
+		for (size_t i = 0; i < ranges; i++)
+		{
+			for (size_t end : ends[2 * i + inString])
+				addLine(end);
+			inString ^= changes[i];
+		}
+		addLine(length);
+
+		// Batches of about the same number of characters
+		size_t parts = lines.size() < threadCount ? lines.size() : threadCount, characters = 0;
+		batches.assign(1, 0);
+		for (size_t r = 0; r < lines.size() && batches.size() < parts; r++)
+		{
+			characters += lines[r].second - lines[r].first;
+			if (characters * parts >= length * batches.size())
+				batches.push_back(r + 1);
+		}
+		batches.push_back(lines.size());
+		while (handlers.size() < batches.size() - 1)
+			handlers.emplace_back(new JSON);
+	}
+
+	inline const std::vector<let>& LineReader::parse(const char* text, size_t length, unsigned flags)
+	{
+		records.clear();
+		split(text, length);
+		records.resize(lines.size());
+		std::vector<std::vector<std::pair<size_t, std::string>>> failed(batches.size() - 1);
+		runThreads(batches.size() - 1, [&](size_t b) {
+			JSON& parser = *handlers[b];
+			for (size_t r = batches[b]; r < batches[b + 1]; r++)
+				if (parser.parseRecord(text + lines[r].first, lines[r].second - lines[r].first, flags, r != batches[b]))
+					records[r].take(parser.content);
+				else
+					failed[b].push_back(std::make_pair(r, parser.errorDescription));
+		});
+		invalid.clear();
+		for (auto& batch : failed)
+			invalid.insert(invalid.end(), batch.begin(), batch.end());
+		return records;
+	}
+
+	template <typename Callback>
+	inline size_t LineReader::forEach(const char* text, size_t length, Callback callback, unsigned flags)
+	{
+		split(text, length);
+		runThreads(batches.size() - 1, [&](size_t b) {
+			JSON& parser = *handlers[b];
+			for (size_t r = batches[b]; r < batches[b + 1]; r++)
+			{
+				parser.parseRecord(text + lines[r].first, lines[r].second - lines[r].first, flags, false);
+				callback(r, (const let&)parser.content, (const JSON&)parser);
+			}
+		});
+		return lines.size();
+	}
+
+	inline const let* JSON::find(const String& path) const
+	{
+		Query query(path);
+		return query.isValid() ? query.first(content) : nullptr;
+	}
+
+	inline bool JSON::project(const std::vector<String>& paths)
+	{
+		std::vector<Projection> nodes(1);
+		for (const String& path : paths)
+		{
+			Query query(path);
+			if (!query.isValid() || !query.singular)
+			{
+				errorDescription = "Cannot project " + path + ": " + (query.isValid() ? "it may select several values" : query.getError());
+				return false;
+			}
+			size_t at = 0;
+			for (const Query::Step& step : query.steps)
+			{
+				const Query::Selector& selector = step.selectors[0];
+				Projection wanted;
+				wanted.named = selector.kind != Query::Selector::Index;
+				wanted.key = selector.key;
+				wanted.index = selector.kind == Query::Selector::Key ? -1 : selector.index;
+				if (selector.kind == Query::Selector::Index && selector.index < 0)
+				{
+					errorDescription = "Cannot project " + path + ": positions from the end are not known before parsing";
+					return false;
+				}
+				size_t next = 0;
+				for (size_t child : nodes[at].children)
+					if (nodes[child].named == wanted.named && nodes[child].key == wanted.key && nodes[child].index == wanted.index)
+						next = child;
+				if (!next)
+				{
+					next = nodes.size();
+					nodes[at].children.push_back(next);
+					nodes[at].last = std::max(nodes[at].last, wanted.index);
+					nodes.push_back(wanted);
+				}
+				at = next;
+			}
+			nodes[at].whole = true;
+		}
+		if (paths.empty())
+			nodes.clear();
+		projection.swap(nodes);
+		return true;
+	}
+
+	inline const JSON::Projection* JSON::projected(const Projection& node, const char* name, size_t length, long long position) const
+	{
+		// Values under a path that ends are built whole
+		if (node.whole)
+			return &node;
+		for (size_t child : node.children)
+		{
+			const Projection& wanted = projection[child];
+			if (name ? wanted.named && wanted.key.size() == length && memcmp(wanted.key.data(), name, length) == 0 : wanted.index == position)
+				return &wanted;
+		}
+		return nullptr;
+	}
+
+	inline void JSON::prune(let& value, const Projection& node)
+	{
+		if (node.whole)
+			return;
+		if (value.idx == 6)
+		{
+			// Kept members move to a new object, in the order of the text
+			Map<Key, let>& members = value._obj->values;
+			let kept = obj();
+			for (size_t i = 0; i < members.Size(); i++)
+			{
+				Key name = members.getId(i);
+				const Projection* child = projected(node, name.str, name.len, -1);
+				if (child && (members[i].idx == 5 || members[i].idx == 6 || child->whole))
+				{
+					prune(members[i], *child);
+					kept._obj->addValue(name, std::move(members[i]));
+				}
+			}
+			recycle(value);
+			value = std::move(kept);
+		}
+		else if (value.idx == 5)
+		{
+			Array& items = *value._array;
+			while ((long long)items.size() > node.last + 1)
+				recycle(items.back()), items.pop_back();
+			for (size_t i = 0; i < items.size(); i++)
+			{
+				const Projection* child = projected(node, nullptr, 0, (long long)i);
+				if (child && (items[i].idx == 5 || items[i].idx == 6 || child->whole))
+					prune(items[i], *child);
+				else
+					recycle(items[i]), items[i] = nullptr;
+			}
+		}
+	}
+
+	inline bool Query::compile(const String& path)
+	{
+		steps.clear(), paths.clear(), expressions.clear();
+		valid = true, errorDescription.clear();
+		Cursor in = { path, 0 };
+		if (path.empty() || path[0] == '/')
+			compilePointer(path);
+		else if (!in.eat("$"))
+			fail("a query starts with / or $", in);
+		else if (compileSteps(in, steps, false))
+		{
+			in.skipSpace();
+			if (in.at < path.size())
+				fail("unexpected character", in);
+		}
+		singular = valid && isSingular(steps);
+		return valid;
+	}
+
+	inline bool Query::compilePointer(const String& path)
+	{
+		for (size_t start = 1; start <= path.size();)
+		{
+			size_t end = path.find('/', start);
+			if (end == String::npos)
+				end = path.size();
+			String token;
+			for (size_t i = start; i < end; i++)
+			{
+				if (path[i] != '~')
+					token += path[i];
+				else if (i + 1 < end && (path[i + 1] == '0' || path[i + 1] == '1'))
+					token += path[++i] == '0' ? '~' : '/';
+				else
+					return fail("~ must be followed by 0 or 1", Cursor{ path, i });
+			}
+			Step step;
+			step.selectors.emplace_back();
+			Selector& selector = step.selectors.back();
+			selector.kind = Selector::Token;
+			setKey(selector, token);
+			// Positions have no leading zeros, "-" is the end of the array and selects nothing
+			bool position = !token.empty() && token.size() < 19 && (token[0] != '0' || token.size() == 1) &&
+							token.find_first_not_of("0123456789") == String::npos;
+			selector.index = position ? atoll(token.c_str()) : -1;
+			steps.push_back(std::move(step));
+			start = end + 1;
+		}
+		return true;
+	}
+
+	inline bool Query::compileSteps(Cursor& in, std::vector<Step>& out, bool inFilter)
+	{
+		for (;;)
+		{
+			size_t saved = in.at;
+			in.skipSpace();
+			if (in.peek() == '[')
+			{
+				out.emplace_back();
+				if (!compileBracket(in, out.back()))
+					return false;
+				continue;
+			}
+			if (in.peek() != '.')
+			{
+				in.at = saved; // The rest of a filter
+				return true;
+			}
+			out.emplace_back();
+			Step& step = out.back();
+			in.at++;
+			if (in.peek() == '.')
+			{
+				step.descendants = true, in.at++;
+				if (in.peek() == '[')
+				{
+					if (!compileBracket(in, step))
+						return false;
+					continue;
+				}
+			}
+			step.selectors.emplace_back();
+			Selector& selector = step.selectors.back();
+			if (in.peek() == '*')
+			{
+				selector.kind = Selector::Wildcard, in.at++;
+				continue;
+			}
+			// Member names: letters, digits, _ and any character out of ASCII
+			size_t start = in.at;
+			while (in.at < in.text.size() && (isalnum((unsigned char)in.text[in.at]) || in.text[in.at] == '_' || (unsigned char)in.text[in.at] >= 0x80))
+				in.at++;
+			if (in.at == start || isdigit((unsigned char)in.text[start]))
+				return fail(inFilter ? "expected a member name in the filter" : "expected a member name", in);
+			selector.kind = Selector::Key;
+			setKey(selector, in.text.substr(start, in.at - start));
+		}
+	}
+
+	inline bool Query::compileBracket(Cursor& in, Step& step)
+	{
+		in.at++; // [
+		do
+		{
+			in.skipSpace();
+			step.selectors.emplace_back();
+			if (!compileSelector(in, step.selectors.back()))
+				return false;
+			in.skipSpace();
+		} while (in.peek() == ',' && in.at++);
+		return in.eat("]") || fail("expected ]", in);
+	}
+
+	inline bool Query::compileSelector(Cursor& in, Selector& selector)
+	{
+		char c = in.peek();
+		if (c == '\'' || c == '"')
+		{
+			String key;
+			if (!compileString(in, key))
+				return false;
+			selector.kind = Selector::Key;
+			setKey(selector, key);
+			return true;
+		}
+		if (c == '*')
+			return selector.kind = Selector::Wildcard, in.at++, true;
+		if (c == '?')
+		{
+			// Both ?(expression) and ?expression are accepted
+			in.at++;
+			selector.kind = Selector::Filter;
+			return compileOr(in, selector.expression);
+		}
+		selector.kind = Selector::Index;
+		bool hasStart = c == '-' || isdigit((unsigned char)c);
+		if (hasStart && !compileInteger(in, selector.index))
+			return false;
+		in.skipSpace();
+		if (in.peek() != ':')
+			return hasStart || fail("expected a selector", in);
+		// Slice start:end:step, every part is optional
+		selector.kind = Selector::Slice, selector.hasIndex = hasStart;
+		in.at++, in.skipSpace();
+		if ((in.peek() == '-' || isdigit((unsigned char)in.peek())) && !(selector.hasEnd = compileInteger(in, selector.end)))
+			return false;
+		in.skipSpace();
+		if (in.peek() != ':')
+			return true;
+		in.at++, in.skipSpace();
+		return !(in.peek() == '-' || isdigit((unsigned char)in.peek())) || compileInteger(in, selector.step);
+	}
+
+	inline bool Query::compileString(Cursor& in, String& out)
+	{
+		char quote = in.text[in.at++];
+		while (in.at < in.text.size() && in.text[in.at] != quote)
+		{
+			if (in.text[in.at] != '\\')
+			{
+				out += in.text[in.at++];
+				continue;
+			}
+			if (in.text.compare(in.at, 2, "\\'") == 0)
+			{
+				out += '\'', in.at += 2;
+				continue;
+			}
+			char decoded[4];
+			int length = 0;
+			const char* next = decodeEscape(in.text.c_str() + in.at, decoded, length);
+			if (!next)
+				return fail("invalid escape", in);
+			out.append(decoded, length);
+			in.at = next - in.text.c_str();
+		}
+		if (in.at >= in.text.size())
+			return fail("unterminated string", in);
+		in.at++;
+		return true;
+	}
+
+	inline bool Query::compileInteger(Cursor& in, long long& out)
+	{
+		size_t start = in.at;
+		if (in.peek() == '-')
+			in.at++;
+		size_t digitsStart = in.at;
+		while (isdigit((unsigned char)in.peek()))
+			in.at++;
+		if (in.at == digitsStart || in.at - digitsStart > 18)
+			return fail("expected an integer", in);
+		out = atoll(in.text.c_str() + start);
+		return true;
+	}
+
+	inline bool Query::compileOr(Cursor& in, size_t& node)
+	{
+		if (!compileAnd(in, node))
+			return false;
+		while (in.eat("||"))
+		{
+			size_t right;
+			if (!compileAnd(in, right))
+				return false;
+			expressions.emplace_back();
+			expressions.back().kind = Expression::Or, expressions.back().left = node, expressions.back().right = right;
+			node = expressions.size() - 1;
+		}
+		return true;
+	}
+
+	inline bool Query::compileAnd(Cursor& in, size_t& node)
+	{
+		if (!compileUnary(in, node))
+			return false;
+		while (in.eat("&&"))
+		{
+			size_t right;
+			if (!compileUnary(in, right))
+				return false;
+			expressions.emplace_back();
+			expressions.back().kind = Expression::And, expressions.back().left = node, expressions.back().right = right;
+			node = expressions.size() - 1;
+		}
+		return true;
+	}
+
+	inline bool Query::compileUnary(Cursor& in, size_t& node)
+	{
+		in.skipSpace();
+		if (in.peek() == '!' && in.text.compare(in.at, 2, "!=") != 0)
+		{
+			in.at++;
+			size_t inner;
+			if (!compileUnary(in, inner))
+				return false;
+			expressions.emplace_back();
+			expressions.back().kind = Expression::Not, expressions.back().left = inner;
+			node = expressions.size() - 1;
+			return true;
+		}
+		if (in.peek() == '(')
+		{
+			in.at++;
+			return compileOr(in, node) && (in.eat(")") || fail("expected )", in));
+		}
+		size_t left;
+		if (!compileOperand(in, left))
+			return false;
+		static const char* const operators[] = { "==", "!=", "<=", ">=", "<", ">" };
+		for (const char* op : operators)
+			if (in.eat(op))
+			{
+				size_t right;
+				if (!compileOperand(in, right))
+					return false;
+				expressions.emplace_back();
+				Expression& comparison = expressions.back();
+				comparison.kind = Expression::Compare, comparison.left = left, comparison.right = right;
+				memcpy(comparison.op, op, strlen(op));
+				node = expressions.size() - 1;
+				return true;
+			}
+		// A path alone tests that it selects something
+		if (expressions[left].kind != Expression::Path)
+			return fail("expected a comparison", in);
+		expressions[left].kind = Expression::Exists;
+		node = left;
+		return true;
+	}
+
+	inline bool Query::compileOperand(Cursor& in, size_t& node)
+	{
+		in.skipSpace();
+		char c = in.peek();
+		Expression operand;
+		if (c == '@' || c == '$')
+		{
+			in.at++;
+			// The steps are compiled apart, their filters add paths too
+			std::vector<Step> path;
+			if (!compileSteps(in, path, true))
+				return false;
+			operand.kind = Expression::Path, operand.relative = c == '@';
+			operand.path = paths.size();
+			paths.push_back(std::move(path));
+		}
+		else if (c == '\'' || c == '"')
+		{
+			String text;
+			if (!compileString(in, text))
+				return false;
+			operand.kind = Expression::Literal, operand.literal = text;
+		}
+		else if (c == '-' || isdigit((unsigned char)c))
+		{
+			const char* start = in.text.c_str() + in.at;
+			char* end = nullptr;
+			double number = strtod(start, &end);
+			if (end == start)
+				return fail("expected a number", in);
+			String text(start, end - start);
+			operand.kind = Expression::Literal;
+			if (text.find_first_of(".eE") == String::npos && text.size() < 19)
+				operand.literal = atoll(text.c_str());
+			else
+				operand.literal = number;
+			in.at += end - start;
+		}
+		else if (in.eat("true") || in.eat("false"))
+			operand.kind = Expression::Literal, operand.literal = in.text[in.at - 1] == 'e' && in.text[in.at - 2] == 'u';
+		else if (in.eat("null"))
+			operand.kind = Expression::Literal, operand.literal = nullptr;
+		else
+			return fail("expected a path or a value", in);
+		expressions.push_back(operand);
+		node = expressions.size() - 1;
+		return true;
+	}
+
+	inline bool Query::fail(const char* description, const Cursor& in)
+	{
+		if (valid)
+			valid = false, errorDescription = String(description) + " at position " + std::to_string(in.at);
+		return false;
+	}
+
+	inline void Query::setKey(Selector& selector, const String& key)
+	{
+		selector.key = key;
+		selector.hash = MapKey<Key>::hash(Key(selector.key.c_str(), selector.key.size()));
+	}
+
+	inline bool Query::isSingular(const std::vector<Step>& path)
+	{
+		for (const Step& step : path)
+			if (step.descendants || step.selectors.size() != 1 || step.selectors[0].kind > Selector::Token)
+				return false;
+		return true;
+	}
+
+	inline const let* Query::first(const let& root) const
+	{
+		if (!valid)
+			return nullptr;
+		if (singular)
+			return walk(steps, root);
+		std::vector<const let*> found;
+		run(steps, root, root, found);
+		return found.empty() ? nullptr : found[0];
+	}
+
+	inline size_t Query::evaluate(const let& root, std::vector<const let*>& out) const
+	{
+		if (!valid)
+			return 0;
+		size_t before = out.size();
+		if (!singular)
+			run(steps, root, root, out);
+		else if (const let* value = walk(steps, root))
+			out.push_back(value);
+		return out.size() - before;
+	}
+
+	inline const let* Query::walk(const std::vector<Step>& path, const let& from) const
+	{
+		const let* value = &from;
+		for (size_t i = 0; value && i < path.size(); i++)
+			value = child(path[i].selectors[0], *value);
+		return value;
+	}
+
+	inline void Query::run(const std::vector<Step>& path, const let& from, const let& root, std::vector<const let*>& out) const
+	{
+		std::vector<const let*> current(1, &from), next;
+		for (const Step& step : path)
+		{
+			next.clear();
+			for (const let* value : current)
+				if (step.descendants)
+					descend(step, *value, root, next);
+				else
+					for (const Selector& selector : step.selectors)
+						select(selector, *value, root, next);
+			current.swap(next);
+			if (current.empty())
+				return;
+		}
+		out.insert(out.end(), current.begin(), current.end());
+	}
+
+	inline const let* Query::child(const Selector& selector, const let& value) const
+	{
+		value.materialize();
+		if (value.idx == 6 && selector.kind != Selector::Index)
+		{
+			const Map<Key, let>& members = value._obj->values;
+			size_t found = members.find(Key(selector.key.c_str(), selector.key.size()), selector.hash);
+			return found == (size_t)-1 ? nullptr : &members[found];
+		}
+		if (value.idx != 5 || selector.kind == Selector::Key)
+			return nullptr;
+		long long size = (long long)value._array->size(), position = selector.index;
+		if (selector.kind == Selector::Index && position < 0)
+			position += size;
+		return position >= 0 && position < size ? &(*value._array)[(size_t)position] : nullptr;
+	}
+
+	inline void Query::select(const Selector& selector, const let& value, const let& root, std::vector<const let*>& out) const
+	{
+		value.materialize();
+		switch (selector.kind)
+		{
+		case Selector::Key:
+		case Selector::Index:
+		case Selector::Token:
+			if (const let* found = child(selector, value))
+				out.push_back(found);
+			break;
+		case Selector::Wildcard:
+		case Selector::Filter:
+			if (value.idx == 5)
+			{
+				for (const let& element : *value._array)
+					if (selector.kind == Selector::Wildcard || test(selector.expression, element, root))
+						out.push_back(&element);
+			}
+			else if (value.idx == 6)
+			{
+				const Map<Key, let>& members = value._obj->values;
+				for (size_t i = 0; i < members.Size(); i++)
+					if (selector.kind == Selector::Wildcard || test(selector.expression, members[i], root))
+						out.push_back(&members[i]);
+			}
+			break;
+		case Selector::Slice:
+		{
+			if (value.idx != 5 || selector.step == 0)
+				break;
+			// Bounds of RFC 9535, negative positions count from the end
+			long long size = (long long)value._array->size(), step = selector.step;
+			long long start = selector.hasIndex ? selector.index : step > 0 ? 0 : size - 1;
+			long long end = selector.hasEnd ? selector.end : step > 0 ? size : -size - 1;
+			start = start < 0 ? start + size : start, end = end < 0 ? end + size : end;
+			if (step > 0)
+			{
+				long long lower = std::min(std::max(start, 0LL), size), upper = std::min(std::max(end, 0LL), size);
+				for (long long i = lower; i < upper; i += step)
+					out.push_back(&(*value._array)[(size_t)i]);
+			}
+			else
+			{
+				long long upper = std::min(std::max(start, -1LL), size - 1), lower = std::min(std::max(end, -1LL), size - 1);
+				for (long long i = upper; i > lower; i += step)
+					out.push_back(&(*value._array)[(size_t)i]);
+			}
+			break;
+		}
+		}
+	}
+
+	inline void Query::descend(const Step& step, const let& value, const let& root, std::vector<const let*>& out) const
+	{
+		for (const Selector& selector : step.selectors)
+			select(selector, value, root, out);
+		if (value.idx == 5)
+			for (const let& element : *value._array)
+				descend(step, element, root, out);
+		else if (value.idx == 6)
+			for (size_t i = 0; i < value._obj->values.Size(); i++)
+				descend(step, value._obj->values[i], root, out);
+	}
+
+	inline bool Query::test(size_t expression, const let& current, const let& root) const
+	{
+		const Expression& node = expressions[expression];
+		switch (node.kind)
+		{
+		case Expression::Or:
+			return test(node.left, current, root) || test(node.right, current, root);
+		case Expression::And:
+			return test(node.left, current, root) && test(node.right, current, root);
+		case Expression::Not:
+			return !test(node.left, current, root);
+		case Expression::Exists:
+			return operand(expression, current, root) != nullptr;
+		case Expression::Compare:
+		{
+			const let* a = operand(node.left, current, root);
+			const let* b = operand(node.right, current, root);
+			// A path that selects nothing only equals another one that selects nothing
+			bool same = a && b ? equal(*a, *b) : a == b;
+			if (node.op[0] == '=' || node.op[0] == '!')
+				return same == (node.op[0] == '=');
+			int order = a && b ? compare(*a, *b) : 2;
+			if (order == 2)
+				return false;
+			return node.op[0] == '<' ? order < 0 || (node.op[1] == '=' && order == 0) : order > 0 || (node.op[1] == '=' && order == 0);
+		}
+		default:
+			return false;
+		}
+	}
+
+	inline const let* Query::operand(size_t expression, const let& current, const let& root) const
+	{
+		const Expression& node = expressions[expression];
+		if (node.kind == Expression::Literal)
+			return &node.literal;
+		const std::vector<Step>& path = paths[node.path];
+		const let& from = node.relative ? current : root;
+		if (isSingular(path))
+			return walk(path, from);
+		std::vector<const let*> found;
+		run(path, from, root, found);
+		return found.empty() ? nullptr : found[0];
+	}
+
+	inline bool Query::equal(const let& a, const let& b)
+	{
+		a.materialize(), b.materialize();
+		bool numbers = a.idx >= 2 && a.idx <= 4 && b.idx >= 2 && b.idx <= 4;
+		if (numbers)
+			return compare(a, b) == 0;
+		if (a.idx != b.idx)
+			return false;
+		switch (a.idx)
+		{
+		case 0:
+			return a._len == b._len && memcmp(a._str, b._str, a._len) == 0;
+		case 1:
+			return a._bool == b._bool;
+		case 5:
+		{
+			if (a._array->size() != b._array->size())
+				return false;
+			for (size_t i = 0; i < a._array->size(); i++)
+				if (!equal((*a._array)[i], (*b._array)[i]))
+					return false;
+			return true;
+		}
+		case 6:
+		{
+			const Map<Key, let>&left = a._obj->values, &right = b._obj->values;
+			if (left.Size() != right.Size())
+				return false;
+			for (size_t i = 0; i < left.Size(); i++)
+			{
+				size_t found = right.find(left.getId(i));
+				if (found == (size_t)-1 || !equal(left[i], right[found]))
+					return false;
+			}
+			return true;
+		}
+		default:
+			return true; // null
+		}
+	}
+
+	inline int Query::compare(const let& a, const let& b)
+	{
+		a.materialize(), b.materialize();
+		if (a.idx >= 2 && a.idx <= 4 && b.idx >= 2 && b.idx <= 4)
+		{
+			if (a.idx == 2 && b.idx == 2)
+				return a._int < b._int ? -1 : a._int > b._int;
+			long double x = a.idx == 2 ? (long double)a._int : a.idx == 3 ? a._float : a._double;
+			long double y = b.idx == 2 ? (long double)b._int : b.idx == 3 ? b._float : b._double;
+			return x < y ? -1 : x > y ? 1 : x == y ? 0 : 2;
+		}
+		if (a.idx == 0 && b.idx == 0)
+		{
+			int order = memcmp(a._str, b._str, std::min(a._len, b._len));
+			return order ? (order < 0 ? -1 : 1) : a._len < b._len ? -1 : a._len > b._len;
+		}
+		return 2; // Not ordered
+	}
+
 } // namespace json
 
 #endif
\ No newline at end of file
@@ -0,0 +1,2186 @@
+/**
+ * @file JSONppSchema.h
+ * @brief JSON Schema (draft-07) validation
+ *
+ * Schema::compile reads a schema once and turns every subschema into a node, a
+ * list of checks ready to run: $ref is resolved to the node it points to,
+ * pattern and patternProperties are compiled regular expressions, the names of
+ * properties are hashed, enum and const are sets of canonical texts and the
+ * members of allOf are merged into the node that holds them. Schema::validate
+ * runs the checks of the root node against an instance without reading the
+ * schema again, so a compiled schema can check any number of instances, from
+ * several threads at the same time. Instances of a lazy document (parseLazy)
+ * are parsed while they are read and must be checked by one thread at a time.
+ *
+ * Schema::validateText checks a JSON text while it is parsed, without building
+ * its tree: the parser events (JSON::parseEvents) carry the schema position
+ * through the keys and elements, and the parser stops at the first failed
+ * keyword. Only the values checked by a keyword that needs them whole (enum,
+ * const, uniqueItems, contains, anyOf, oneOf, not, if and dependencies with a
+ * schema) are built, and checked when they end.
+ *
+ * Regular expressions use std::wregex with the ECMAScript grammar; \d \w \s
+ * and their negations are rewritten to their ECMA 262 meaning. Characters
+ * outside the Basic Multilingual Plane need a 32 bits wchar_t (Linux, macOS).
+ *
+ * The formats of draft-07 are checked, idn-hostname with a subset of the
+ * IDNA 2008 rules: Punycode, hyphens, leading combining marks and the
+ * contextual rules of RFC 5892.
+ */
+
+#pragma once
+
+#ifndef _JSONPP_SCHEMA_
+#define _JSONPP_SCHEMA_
+
+#include "JSONpp.h"
+#include <regex>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <cstdio>
+#include <deque>
+
+namespace json
+{
+	/** Schema class
+	 * @brief JSON Schema (draft-07) compiled for validation. Errors are not
+	 * thrown: compile() and addDocument() return false and describe the
+	 * problem in getError()
+	 */
+	class Schema
+	{
+	public:
+		Schema() = default;
+		Schema(const Schema&) = delete;
+		Schema& operator=(const Schema&) = delete;
+		/** addDocument()
+		 * @brief Makes a schema available to the $ref of the schemas compiled
+		 * later, as if it was downloaded from its URI. The draft-07 metaschema
+		 * is always available
+		 * @param uri Absolute URI of the document
+		 * @param text JSON text of the document
+		 * @return false if the text is not valid JSON
+		 */
+		bool addDocument(const char* uri, const char* text);
+		/** compile()
+		 * @brief Compiles a schema, replacing the previous one. The schema is
+		 * only read during the call
+		 * @param schema Root of the schema, an object or a boolean
+		 * @param uri Base URI of the schema, used to resolve relative $ref and $id
+		 * @return false if the schema cannot be compiled (see getError())
+		 */
+		bool compile(const let& schema, const char* uri = "");
+		/** compile()
+		 * @brief Parses and compiles the text of a schema
+		 * @param text JSON text of the schema
+		 * @param uri Base URI of the schema
+		 * @return false if the text or the schema is not valid
+		 */
+		bool compile(const char* text, const char* uri = "");
+		/** validate()
+		 * @brief Checks an instance against the compiled schema. Several threads
+		 * may check instances at the same time, unless they read the same lazy
+		 * document (see JSON::Parse())
+		 * @param instance Value to check
+		 * @param reason If given, receives the first failed keyword and the JSON
+		 * Pointer of the value that failed it, as "minimum at /items/3"
+		 * @return true if the instance is valid
+		 */
+		bool validate(const let& instance, std::string* reason = nullptr) const;
+		/** validateText()
+		 * @brief Checks a JSON text against the compiled schema while it is
+		 * parsed, without building its tree. Parsing stops at the first failed
+		 * keyword and the text is not indexed first (parseNoIndex), so invalid
+		 * texts are rejected after reading them up to the failed value
+		 * @param text NUL terminated JSON text
+		 * @param reason If given, receives the first failed keyword and where it
+		 * failed, as validate() does, or the parse error of an invalid text
+		 * @param flags Combination of ParseFlags, see JSON::parseEvents()
+		 * @return true if the text is valid JSON and valid against the schema
+		 */
+		bool validateText(const char* text, std::string* reason = nullptr, unsigned flags = parseDefault) const;
+		// Returns true if the last compile() succeeded
+		bool isValid() const { return compiled; }
+		// Description of the last compile() or addDocument() error
+		const std::string& getError() const { return errorDescription; }
+
+	private:
+		static const size_t npos = (size_t)-1;
+		// Operation of a check, in the order of the keyword names of keywordOf()
+		enum class Op : unsigned char
+		{
+			False,
+			Type,
+			Enum,
+			Minimum,
+			Maximum,
+			ExclusiveMinimum,
+			ExclusiveMaximum,
+			MultipleOf,
+			MinLength,
+			MaxLength,
+			Pattern,
+			Format,
+			Content,
+			MinItems,
+			MaxItems,
+			UniqueItems,
+			Items,
+			TupleItems,
+			Contains,
+			MinProperties,
+			MaxProperties,
+			Required,
+			Properties,
+			PropertyNames,
+			DependentRequired,
+			DependentSchema,
+			AllOf,
+			AnyOf,
+			OneOf,
+			Not,
+			IfThenElse,
+			Ref
+		};
+		// Bits of the type keyword, integers have both typeNumber and typeInteger
+		enum TypeBits : unsigned
+		{
+			typeNull = 1,
+			typeBoolean = 2,
+			typeObject = 4,
+			typeArray = 8,
+			typeNumber = 16,
+			typeString = 32,
+			typeInteger = 64
+		};
+		// Formats of draft-07, unknown formats are not checked
+		enum Format : unsigned
+		{
+			formatDateTime,
+			formatDate,
+			formatTime,
+			formatEmail,
+			formatIdnEmail,
+			formatHostname,
+			formatIdnHostname,
+			formatIpv4,
+			formatIpv6,
+			formatUri,
+			formatUriReference,
+			formatIri,
+			formatIriReference,
+			formatUriTemplate,
+			formatJsonPointer,
+			formatRelativeJsonPointer,
+			formatRegex
+		};
+		// Bits of a Content check
+		enum ContentBits : unsigned
+		{
+			contentBase64 = 1,
+			contentJson = 2
+		};
+		// Compiled keyword
+		struct Check
+		{
+			Op op;
+			unsigned code = 0;				 // Type bits, format or content bits
+			size_t node = npos;				 // Subschema: items, contains, not, if, additionalItems, $ref target
+			size_t then = npos;				 // then of if
+			size_t otherwise = npos;		 // else of if
+			size_t table = npos;			 // Position in sets, regexes or members
+			long double number = 0;			 // Limit of numeric, length and count keywords
+			std::vector<size_t> nodes;		 // Subschemas of allOf, anyOf, oneOf and tuple items
+			std::vector<Key> names;		 // Keys of required and dependencies, interned in keys
+			Check(Op _op) : op(_op) {}
+		};
+		// Compiled properties, patternProperties and additionalProperties
+		struct Members
+		{
+			Map<Key, size_t> named;							 // Node of every key of properties
+			std::vector<std::pair<size_t, size_t>> patterns; // Regex and node of patternProperties
+			size_t additional = npos;						 // Node of additionalProperties
+		};
+		// Document given to addDocument()
+		struct Document
+		{
+			std::string uri;				// URI of the document, without fragment
+			std::unique_ptr<JSON> handler; // Handler that owns the tree
+			const let* root;
+		};
+		// Schema that a URI points to
+		struct Resource
+		{
+			const let* schema;
+			std::string base; // Base URI inside the schema
+		};
+		// Position of a value in the instance, kept on the stack while validating
+		struct Path
+		{
+			const Path* parent;
+			Key key;		 // Key of the value in its object, no characters in arrays
+			size_t index;	 // Position of the value in its array
+		};
+		// Parts of a URI reference (RFC 3986)
+		struct Uri
+		{
+			std::string scheme, authority, path, query, fragment;
+			bool hasScheme = false, hasAuthority = false, hasQuery = false, hasFragment = false;
+		};
+
+		/** compileNode()
+		 * @brief Compiles a subschema, once: later calls return the same node,
+		 * also while the first one is still running (recursive $ref)
+		 * @param schema Subschema
+		 * @param base Base URI around the subschema
+		 * @return Position of the node
+		 */
+		size_t compileNode(const let& schema, const std::string& base);
+		// Compiles the keywords of an object schema into checks
+		void compileKeywords(const let& schema, const std::string& base, std::vector<Check>& checks);
+		// Compiles properties, patternProperties and additionalProperties
+		void compileMembers(const let& schema, const std::string& base, std::vector<Check>& checks);
+		// Compiles a regular expression, false if it is not valid
+		bool compileRegex(const let& pattern, size_t& position);
+		/** index()
+		 * @brief Records the base URI of every subschema and the URIs set by $id
+		 * @param schema Subschema
+		 * @param base Base URI around the subschema
+		 */
+		void index(const let& schema, const std::string& base);
+		// Registers a parsed document and its subschemas under a URI
+		void addResource(const std::string& uri, const let& schema);
+		// Finds the schema of a $ref
+		bool resolve(const std::string& ref, const std::string& base, Resource& target) const;
+		// Reports a compilation error, the first one is kept
+		void fail(const std::string& description)
+		{
+			if (compiled)
+				compiled = false, errorDescription = description;
+		}
+
+		struct Stream; // Handler of the parser events of validateText()
+		bool validateNode(size_t node, const let& value, const Path* path, std::string* reason) const;
+		// Adds a node and the nodes its $ref and allOf checks apply, once each
+		void expand(size_t node, std::vector<size_t>& out) const;
+		bool run(const Check& check, const let& value, const Path* path, std::string* reason) const;
+		bool checkFormat(unsigned format, const char* str, size_t len) const;
+		bool checkContent(unsigned content, const char* str, size_t len) const;
+		// Sets the reason of a failed check, the deepest one is kept
+		static bool reject(const Check& check, const Path* path, std::string* reason);
+		static const char* keywordOf(Op op);
+		static std::string pointerOf(const Path* path);
+
+		// Instance helpers
+		static const let* member(const let& object, const char* key);
+		static unsigned typeOf(const let& value);
+		static long double numberOf(const let& value);
+		static std::string canonical(const let& value);
+		static void canonical(const let& value, std::string& out);
+
+		// Text helpers
+		static size_t codePoints(const char* str, size_t len);
+		static std::wstring widen(const char* str, size_t len);
+		static std::u32string decodeUtf8(const char* str, size_t len);
+		static std::wstring translateRegex(const std::wstring& pattern);
+		static Uri parseUri(const std::string& text);
+		static std::string removeDotSegments(const std::string& path);
+		static std::string resolveUri(const std::string& base, const std::string& ref);
+		static std::string withoutFragment(const std::string& uri);
+		static bool decodeBase64(const char* str, size_t len, std::string* out);
+
+		// Formats
+		static bool digits(const char* str, size_t len);
+		static int twoDigits(const char* str) { return (str[0] - '0') * 10 + str[1] - '0'; }
+		static bool isDate(const char* str, size_t len);
+		static bool isTime(const char* str, size_t len);
+		static bool isDateTime(const char* str, size_t len);
+		static bool isEmail(const char* str, size_t len, bool international);
+		static bool isHostname(const char* str, size_t len);
+		static bool isIdnHostname(const char* str, size_t len);
+		static bool isIdnLabel(const std::u32string& label);
+		static bool isIpv4(const char* str, size_t len);
+		static bool isIpv6(const char* str, size_t len);
+		static bool isUri(const char* str, size_t len, bool international, bool reference);
+		static bool isUriTemplate(const char* str, size_t len);
+		static bool isJsonPointer(const char* str, size_t len);
+		static bool isRelativeJsonPointer(const char* str, size_t len);
+		static bool punycodeDecode(const std::string& text, std::u32string& out);
+		static size_t punycodeLength(const std::u32string& label);
+		static unsigned punycodeAdapt(unsigned long long delta, unsigned long long points, bool first);
+		static const char* metaschemaText();
+
+		std::vector<std::vector<Check>> nodes;				 // Checks of every node, the root is node 0
+		std::vector<bool> ready;							 // True when the checks of a node are complete
+		std::vector<std::unordered_set<std::string>> sets; // Canonical texts of enum and const
+		std::vector<std::wregex> regexes;					 // pattern and patternProperties
+		std::vector<Members> members;						 // properties tables
+		KeyTable keys;										 // Property names of the checks
+		std::unordered_map<const let*, size_t> compiledAt;	 // Node of every compiled subschema
+		std::unordered_map<const let*, std::string> bases;	 // Base URI inside every subschema
+		std::unordered_map<std::string, Resource> resources; // Schemas of absolute URIs and $id names
+		std::vector<Document> documents;					 // Added documents, the metaschema first
+		std::unique_ptr<JSON> source;						 // Handler of the text given to compile()
+		bool compiled = false;								 // Result of the last compile()
+		std::string errorDescription;						 // Description of the last error
+	};
+
+	inline bool Schema::addDocument(const char* uri, const char* text)
+	{
+		std::unique_ptr<JSON> handler(new JSON);
+		const let& root = handler->parseText(text);
+		if (!handler->isValid())
+			return errorDescription = std::string(uri) + ": " + handler->getError(), false;
+		documents.push_back(Document{ withoutFragment(uri), std::move(handler), &root });
+		return true;
+	}
+
+	inline bool Schema::compile(const char* text, const char* uri)
+	{
+		if (!source)
+			source.reset(new JSON);
+		const let& schema = source->parseText(text);
+		if (!source->isValid())
+			return compiled = false, errorDescription = source->getError(), false;
+		return compile(schema, uri);
+	}
+
+	inline bool Schema::compile(const let& schema, const char* uri)
+	{
+		nodes.clear(), ready.clear(), sets.clear(), regexes.clear(), members.clear();
+		keys.clear(), compiledAt.clear(), bases.clear(), resources.clear();
+		compiled = true, errorDescription.clear();
+		if (documents.empty() || documents[0].uri != "http://json-schema.org/draft-07/schema")
+		{
+			std::unique_ptr<JSON> handler(new JSON);
+			const let& root = handler->parseText(metaschemaText());
+			documents.insert(documents.begin(), Document{ "http://json-schema.org/draft-07/schema", std::move(handler), &root });
+		}
+		for (const Document& document : documents)
+			addResource(document.uri, *document.root);
+		addResource(withoutFragment(uri), schema);
+		compileNode(schema, bases[&schema]);
+		if (!compiled)
+			nodes.clear();
+		return compiled;
+	}
+
+	inline void Schema::addResource(const std::string& uri, const let& schema)
+	{
+		resources[uri] = Resource{ &schema, uri };
+		index(schema, uri);
+	}
+
+	inline void Schema::index(const let& schema, const std::string& base)
+	{
+		if (schema.index() != 6)
+			return (void)(bases[&schema] = base);
+		std::string inner = base;
+		const let* id = member(schema, "$id");
+		if (id && id->index() == 0 && !member(schema, "$ref"))
+		{
+			std::string uri = resolveUri(base, id->_str);
+			if (id->_str[0] != '#')
+				inner = withoutFragment(uri), resources[inner] = Resource{ &schema, inner };
+			if (uri != inner)
+				resources[uri] = Resource{ &schema, inner }; // Plain name fragment
+		}
+		bases[&schema] = inner;
+		static const char* const single[] = { "additionalItems", "contains", "additionalProperties", "propertyNames",
+											  "if", "then", "else", "not", "items" };
+		static const char* const lists[] = { "allOf", "anyOf", "oneOf", "items" };
+		static const char* const maps[] = { "properties", "patternProperties", "dependencies", "definitions" };
+		for (const char* keyword : single)
+			if (const let* child = member(schema, keyword))
+				if (child->index() != 5)
+					index(*child, inner);
+		for (const char* keyword : lists)
+			if (const let* child = member(schema, keyword))
+				if (child->index() == 5)
+					for (const let& element : *child->_array)
+						index(element, inner);
+		for (const char* keyword : maps)
+			if (const let* child = member(schema, keyword))
+				if (child->index() == 6)
+				{
+					const Map<Key, let>& entries = child->_obj->values;
+					for (size_t i = 0; i < entries.Size(); i++)
+						index(entries[i], inner);
+				}
+	}
+
+	inline bool Schema::resolve(const std::string& ref, const std::string& base, Resource& target) const
+	{
+		std::string uri = resolveUri(base, ref);
+		std::unordered_map<std::string, Resource>::const_iterator found = resources.find(uri);
+		if (found != resources.end())
+			return target = found->second, true;
+		size_t hash = uri.find('#');
+		found = resources.find(uri.substr(0, hash));
+		if (found == resources.end())
+			return false;
+		target = found->second;
+		if (hash == std::string::npos || hash + 1 == uri.size())
+			return true;
+		// JSON Pointer fragment, percent encoded
+		std::string pointer;
+		for (size_t i = hash + 1; i < uri.size(); i++)
+		{
+			if (uri[i] == '%' && i + 2 < uri.size() && isxdigit((unsigned char)uri[i + 1]) && isxdigit((unsigned char)uri[i + 2]))
+				pointer += (char)strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16), i += 2;
+			else
+				pointer += uri[i];
+		}
+		if (pointer[0] != '/')
+			return false;
+		const let* current = target.schema;
+		for (size_t start = 1; start <= pointer.size();)
+		{
+			size_t end = std::min(pointer.find('/', start), pointer.size());
+			std::string token;
+			for (size_t i = start; i < end; i++)
+				if (pointer[i] == '~' && i + 1 < end && (pointer[i + 1] == '0' || pointer[i + 1] == '1'))
+					token += pointer[++i] == '0' ? '~' : '/';
+				else
+					token += pointer[i];
+			if (current->index() == 6)
+				current = member(*current, token.c_str());
+			else if (current->index() == 5 && !token.empty() && digits(token.data(), token.size()))
+			{
+				size_t position = strtoul(token.c_str(), nullptr, 10);
+				current = position < current->_array->size() ? &(*current->_array)[position] : nullptr;
+			}
+			else
+				current = nullptr;
+			if (!current)
+				return false;
+			start = end + 1;
+		}
+		std::unordered_map<const let*, std::string>::const_iterator inner = bases.find(current);
+		if (inner != bases.end())
+			target.base = inner->second;
+		target.schema = current;
+		return true;
+	}
+
+	inline size_t Schema::compileNode(const let& schema, const std::string& base)
+	{
+		std::unordered_map<const let*, size_t>::iterator found = compiledAt.find(&schema);
+		if (found != compiledAt.end())
+			return found->second;
+		size_t node = nodes.size();
+		compiledAt[&schema] = node;
+		nodes.emplace_back(), ready.push_back(false);
+		std::unordered_map<const let*, std::string>::iterator inner = bases.find(&schema);
+		const std::string innerBase = inner != bases.end() ? inner->second : base;
+		std::vector<Check> checks;
+		switch (schema.index())
+		{
+		case 1:
+			if (!schema._bool)
+				checks.emplace_back(Op::False);
+			break;
+		case 6:
+			if (const let* ref = member(schema, "$ref"))
+			{
+				// Keywords next to $ref are ignored in draft-07
+				Resource target;
+				if (ref->index() != 0 || !resolve(ref->_str, innerBase, target))
+				{
+					fail("unresolvable $ref " + (ref->index() == 0 ? std::string(ref->_str) : std::string()) + " from " + innerBase);
+					break;
+				}
+				checks.emplace_back(Op::Ref);
+				checks.back().node = compileNode(*target.schema, target.base);
+			}
+			else
+				compileKeywords(schema, innerBase, checks);
+			break;
+		default:
+			fail("a schema must be an object or a boolean");
+		}
+		nodes[node] = std::move(checks);
+		ready[node] = true;
+		return node;
+	}
+
+	inline void Schema::compileKeywords(const let& schema, const std::string& base, std::vector<Check>& checks)
+	{
+		if (const let* type = member(schema, "type"))
+		{
+			static const char* const names[] = { "null", "boolean", "object", "array", "number", "string", "integer" };
+			checks.emplace_back(Op::Type);
+			const Array single(1, *type);
+			const Array& list = type->index() == 5 ? *type->_array : single;
+			for (const let& name : list)
+				for (unsigned bit = 0; bit < 7; bit++)
+					if (name.index() == 0 && !strcmp(name._str, names[bit]))
+						checks.back().code |= 1u << bit;
+		}
+		const let* constant = member(schema, "const");
+		const let* values = member(schema, "enum");
+		if (constant || (values && values->index() == 5))
+		{
+			checks.emplace_back(Op::Enum);
+			checks.back().table = sets.size();
+			sets.emplace_back();
+			if (constant)
+				sets.back().insert(canonical(*constant));
+			else
+				for (const let& value : *values->_array)
+					sets.back().insert(canonical(value));
+			if (constant && values && values->index() == 5)
+			{
+				checks.emplace_back(Op::Enum);
+				checks.back().table = sets.size();
+				sets.emplace_back();
+				for (const let& value : *values->_array)
+					sets.back().insert(canonical(value));
+			}
+		}
+		static const std::pair<const char*, Op> limits[] = {
+			{ "minimum", Op::Minimum }, { "maximum", Op::Maximum }, { "exclusiveMinimum", Op::ExclusiveMinimum },
+			{ "exclusiveMaximum", Op::ExclusiveMaximum }, { "multipleOf", Op::MultipleOf }, { "minLength", Op::MinLength },
+			{ "maxLength", Op::MaxLength }, { "minItems", Op::MinItems }, { "maxItems", Op::MaxItems },
+			{ "minProperties", Op::MinProperties }, { "maxProperties", Op::MaxProperties }
+		};
+		for (const std::pair<const char*, Op>& limit : limits)
+			if (const let* value = member(schema, limit.first))
+				if (typeOf(*value) & typeNumber)
+					checks.emplace_back(limit.second), checks.back().number = numberOf(*value);
+		if (const let* pattern = member(schema, "pattern"))
+		{
+			checks.emplace_back(Op::Pattern);
+			if (!compileRegex(*pattern, checks.back().table))
+				return fail("invalid pattern");
+		}
+		if (const let* format = member(schema, "format"))
+		{
+			static const char* const names[] = { "date-time", "date", "time", "email", "idn-email", "hostname",
+												 "idn-hostname", "ipv4", "ipv6", "uri", "uri-reference", "iri",
+												 "iri-reference", "uri-template", "json-pointer",
+												 "relative-json-pointer", "regex" };
+			for (unsigned i = 0; i <= formatRegex; i++)
+				if (format->index() == 0 && !strcmp(format->_str, names[i]))
+					checks.emplace_back(Op::Format), checks.back().code = i;
+		}
+		const let* encoding = member(schema, "contentEncoding");
+		const let* media = member(schema, "contentMediaType");
+		unsigned content = (encoding && encoding->index() == 0 && !strcmp(encoding->_str, "base64") ? (unsigned)contentBase64 : 0u) |
+						   (media && media->index() == 0 && !strcmp(media->_str, "application/json") ? (unsigned)contentJson : 0u);
+		if (content)
+			checks.emplace_back(Op::Content), checks.back().code = content;
+		if (const let* unique = member(schema, "uniqueItems"))
+			if (unique->index() == 1 && unique->_bool)
+				checks.emplace_back(Op::UniqueItems);
+		if (const let* items = member(schema, "items"))
+		{
+			if (items->index() == 5)
+			{
+				checks.emplace_back(Op::TupleItems);
+				std::vector<size_t> tuple;
+				for (const let& item : *items->_array)
+					tuple.push_back(compileNode(item, base));
+				size_t additional = npos;
+				if (const let* rest = member(schema, "additionalItems"))
+					additional = compileNode(*rest, base);
+				// checks may have grown while compiling the subschemas
+				checks.back().nodes = std::move(tuple), checks.back().node = additional;
+			}
+			else
+			{
+				size_t node = compileNode(*items, base);
+				checks.emplace_back(Op::Items), checks.back().node = node;
+			}
+		}
+		if (const let* contains = member(schema, "contains"))
+		{
+			size_t node = compileNode(*contains, base);
+			checks.emplace_back(Op::Contains), checks.back().node = node;
+		}
+		if (const let* required = member(schema, "required"))
+			if (required->index() == 5 && !required->_array->empty())
+			{
+				checks.emplace_back(Op::Required);
+				for (const let& name : *required->_array)
+					if (name.index() == 0)
+						checks.back().names.push_back(keys.intern(name._str, name._len));
+			}
+		compileMembers(schema, base, checks);
+		if (const let* names = member(schema, "propertyNames"))
+		{
+			size_t node = compileNode(*names, base);
+			checks.emplace_back(Op::PropertyNames), checks.back().node = node;
+		}
+		if (const let* dependencies = member(schema, "dependencies"))
+			if (dependencies->index() == 6)
+			{
+				const Map<Key, let>& entries = dependencies->_obj->values;
+				for (size_t i = 0; i < entries.Size(); i++)
+				{
+					Key key = keys.intern(entries.getId(i));
+					if (entries[i].index() == 5)
+					{
+						checks.emplace_back(Op::DependentRequired);
+						checks.back().names.push_back(key);
+						for (const let& name : *entries[i]._array)
+							if (name.index() == 0)
+								checks.back().names.push_back(keys.intern(name._str, name._len));
+					}
+					else
+					{
+						size_t node = compileNode(entries[i], base);
+						checks.emplace_back(Op::DependentSchema);
+						checks.back().names.push_back(key), checks.back().node = node;
+					}
+				}
+			}
+		static const std::pair<const char*, Op> combinations[] = { { "allOf", Op::AllOf }, { "anyOf", Op::AnyOf }, { "oneOf", Op::OneOf } };
+		for (const std::pair<const char*, Op>& combination : combinations)
+		{
+			const let* list = member(schema, combination.first);
+			if (!list || list->index() != 5)
+				continue;
+			std::vector<size_t> branches;
+			for (const let& branch : *list->_array)
+			{
+				size_t node = compileNode(branch, base);
+				// The checks of a complete allOf member are merged into this node
+				if (combination.second == Op::AllOf && ready[node])
+					checks.insert(checks.end(), nodes[node].begin(), nodes[node].end());
+				else
+					branches.push_back(node);
+			}
+			if (!branches.empty())
+				checks.emplace_back(combination.second), checks.back().nodes = std::move(branches);
+		}
+		if (const let* negated = member(schema, "not"))
+		{
+			size_t node = compileNode(*negated, base);
+			checks.emplace_back(Op::Not), checks.back().node = node;
+		}
+		const let* condition = member(schema, "if");
+		const let* then = member(schema, "then");
+		const let* otherwise = member(schema, "else");
+		if (condition && (then || otherwise))
+		{
+			size_t node = compileNode(*condition, base);
+			size_t thenNode = then ? compileNode(*then, base) : npos;
+			size_t elseNode = otherwise ? compileNode(*otherwise, base) : npos;
+			checks.emplace_back(Op::IfThenElse);
+			checks.back().node = node, checks.back().then = thenNode, checks.back().otherwise = elseNode;
+		}
+	}
+
+	inline void Schema::compileMembers(const let& schema, const std::string& base, std::vector<Check>& checks)
+	{
+		const let* properties = member(schema, "properties");
+		const let* patterns = member(schema, "patternProperties");
+		const let* additional = member(schema, "additionalProperties");
+		if (!properties && !patterns && !additional)
+			return;
+		Members table;
+		if (properties && properties->index() == 6)
+		{
+			const Map<Key, let>& entries = properties->_obj->values;
+			for (size_t i = 0; i < entries.Size(); i++)
+				table.named.insert(keys.intern(entries.getId(i)), compileNode(entries[i], base));
+			// Builds the hash index now, so validate() does not write it
+			size_t zero = 0;
+			Key first = entries.Size() ? table.named.getId(zero) : Key("");
+			table.named.find(first);
+		}
+		if (patterns && patterns->index() == 6)
+		{
+			const Map<Key, let>& entries = patterns->_obj->values;
+			for (size_t i = 0; i < entries.Size(); i++)
+			{
+				Key key = entries.getId(i);
+				let pattern;
+				pattern.setString(key.str, key.len);
+				size_t regex = npos;
+				if (!compileRegex(pattern, regex))
+					return fail("invalid patternProperties " + std::string(key.str, key.len));
+				table.patterns.emplace_back(regex, compileNode(entries[i], base));
+			}
+		}
+		if (additional)
+			table.additional = compileNode(*additional, base);
+		checks.emplace_back(Op::Properties), checks.back().table = members.size();
+		members.push_back(std::move(table));
+	}
+
+	inline bool Schema::compileRegex(const let& pattern, size_t& position)
+	{
+		if (pattern.index() != 0)
+			return false;
+		try
+		{
+			regexes.emplace_back(translateRegex(widen(pattern._str, pattern._len)), std::regex::ECMAScript);
+		}
+		catch (const std::regex_error&)
+		{
+			return false;
+		}
+		position = regexes.size() - 1;
+		return true;
+	}
+
+	inline bool Schema::validate(const let& instance, std::string* reason) const
+	{
+		if (reason)
+			reason->clear();
+		if (nodes.empty())
+		{
+			if (reason)
+				*reason = "the schema is not compiled";
+			return false;
+		}
+		return validateNode(0, instance, nullptr, reason);
+	}
+
+	/** Stream struct
+	 * @brief Handler of the parser events of validateText(). Every open object
+	 * or array has a frame with the checks that run while it is parsed, and
+	 * each of its members or elements gets its nodes from properties or items
+	 * when its key or position arrives. Scalars are checked as soon as they are
+	 * parsed. Checks that need a whole value build its tree in the frame
+	 */
+	struct Schema::Stream : EventHandler
+	{
+		// Open object or array
+		struct Frame
+		{
+			Path at;								// Position of the value, unused by the root
+			bool root = false;						// True for the root of the text
+			bool object = false;					// True for objects, false for arrays
+			size_t count = 0;						// Members or elements so far
+			std::vector<const Check*> checks;		// Checks that run while the value is parsed
+			std::vector<const Check*> deferred;		// Checks that run on the built value
+			std::vector<size_t> next;				// Nodes of the member or element being parsed
+			std::string key;						// Key of the member being parsed
+			std::unordered_set<std::string> seen;	// Keys so far, kept when the object has checks
+			bool tracksKeys = false;				// True when seen is kept
+			let* value = nullptr;					// Built value, when a deferred check needs it
+			std::unique_ptr<let> owned;				// Built value, when no outer value holds it
+			const Path* path() const { return root ? nullptr : &at; }
+		};
+		Stream(const Schema& _schema, std::string* _reason) : schema(_schema), reason(_reason), root(1, 0) {}
+		bool onObjectStart() { return open(true); }
+		bool onArrayStart() { return open(false); }
+		bool onObjectEnd() { return close(); }
+		bool onArrayEnd() { return close(); }
+		bool onKey(const char* key, size_t length);
+		bool onString(const char* str, size_t length)
+		{
+			let value;
+			value.setString(str, length);
+			return scalar(value, true);
+		}
+		bool onNumber(long long number)
+		{
+			let value(number);
+			return scalar(value, false);
+		}
+		bool onNumber(double number)
+		{
+			let value(number);
+			return scalar(value, false);
+		}
+		bool onBool(bool boolean)
+		{
+			let value(boolean);
+			return scalar(value, false);
+		}
+		bool onNull()
+		{
+			let value(nullptr);
+			return scalar(value, false);
+		}
+
+		const Schema& schema;
+		std::string* reason;
+		std::deque<Frame> frames; // Open values, the deque keeps the paths of the outer ones in place
+		std::vector<size_t> root; // Nodes of the root value
+		KeyTable keys;			  // Keys of the built values
+		bool failed = false;	  // True when a check stopped the parser
+		bool started = false;	  // True once the root value starts
+
+	private:
+		// Starts a value in the open array, and finds the nodes of that element
+		bool enter();
+		// Position of the value that starts, nullptr for the root
+		const Path* position(Path& storage) const;
+		// Adds the value that starts to the built value of its frame
+		let* slot();
+		bool scalar(const let& value, bool borrowed);
+		bool open(bool object);
+		bool close();
+		bool reject(const Check& check, const Path* path) { return failed = true, Schema::reject(check, path, reason); }
+	};
+
+	inline bool Schema::validateText(const char* text, std::string* reason, unsigned flags) const
+	{
+		if (reason)
+			reason->clear();
+		if (nodes.empty())
+		{
+			if (reason)
+				*reason = "the schema is not compiled";
+			return false;
+		}
+		Stream stream(*this, reason);
+		JSON reader;
+		if (reader.parseEvents(text, stream, flags | parseNoIndex) && stream.started)
+			return true;
+		if (reason && !stream.failed)
+			*reason = stream.started ? reader.getError() : "the text has no value";
+		return false;
+	}
+
+	inline void Schema::expand(size_t node, std::vector<size_t>& out) const
+	{
+		if (std::find(out.begin(), out.end(), node) != out.end())
+			return;
+		out.push_back(node);
+		for (const Check& check : nodes[node])
+			if (check.op == Op::Ref)
+				expand(check.node, out);
+			else if (check.op == Op::AllOf)
+				for (size_t inner : check.nodes)
+					expand(inner, out);
+	}
+
+	inline bool Schema::Stream::enter()
+	{
+		started = true;
+		if (frames.empty() || frames.back().object)
+			return true;
+		Frame& frame = frames.back();
+		size_t position = frame.count++;
+		frame.next.clear();
+		for (const Check* check : frame.checks)
+			switch (check->op)
+			{
+			case Op::MaxItems:
+				if (frame.count > check->number)
+					return reject(*check, frame.path());
+				break;
+			case Op::Items:
+				frame.next.push_back(check->node);
+				break;
+			case Op::TupleItems:
+			{
+				size_t node = position < check->nodes.size() ? check->nodes[position] : check->node;
+				if (node != npos)
+					frame.next.push_back(node);
+				break;
+			}
+			default:
+				break;
+			}
+		return true;
+	}
+
+	inline const Schema::Path* Schema::Stream::position(Path& storage) const
+	{
+		if (frames.empty())
+			return nullptr;
+		const Frame& frame = frames.back();
+		storage = Path{ frame.path(), frame.object ? Key(frame.key.c_str(), frame.key.size()) : Key(), frame.count - 1 };
+		return &storage;
+	}
+
+	inline let* Schema::Stream::slot()
+	{
+		if (frames.empty() || !frames.back().value)
+			return nullptr;
+		Frame& frame = frames.back();
+		if (frame.object)
+			return frame.value->_obj->addMember(keys.intern(frame.key.c_str(), frame.key.size()));
+		frame.value->_array->emplace_back();
+		return &frame.value->_array->back();
+	}
+
+	inline bool Schema::Stream::scalar(const let& value, bool borrowed)
+	{
+		if (!enter())
+			return false;
+		Path storage;
+		const Path* path = position(storage);
+		for (size_t node : frames.empty() ? root : frames.back().next)
+			if (!schema.validateNode(node, value, path, reason))
+				return failed = true, false;
+		if (let* target = slot())
+		{
+			// Strings of the parser only live during the event
+			if (borrowed)
+				target->setValue(String(value._str, value._len));
+			else
+				*target = value;
+		}
+		return true;
+	}
+
+	inline bool Schema::Stream::open(bool object)
+	{
+		if (!enter())
+			return false;
+		Path storage;
+		const Path* path = position(storage);
+		std::vector<size_t> active;
+		for (size_t node : frames.empty() ? root : frames.back().next)
+			schema.expand(node, active);
+		let* target = slot();
+		frames.emplace_back();
+		Frame& frame = frames.back();
+		frame.root = !path, frame.object = object;
+		if (path)
+			frame.at = *path;
+		for (size_t node : active)
+			for (const Check& check : schema.nodes[node])
+				switch (check.op)
+				{
+				case Op::False:
+					return reject(check, frame.path());
+				case Op::Type:
+					if (!(check.code & (object ? typeObject : typeArray)))
+						return reject(check, frame.path());
+					break;
+				case Op::MinItems:
+				case Op::MaxItems:
+				case Op::Items:
+				case Op::TupleItems:
+					if (!object)
+						frame.checks.push_back(&check);
+					break;
+				case Op::Required:
+				case Op::DependentRequired:
+				case Op::MinProperties:
+				case Op::MaxProperties:
+				case Op::Properties:
+				case Op::PropertyNames:
+					if (object)
+						frame.checks.push_back(&check);
+					break;
+				case Op::UniqueItems:
+				case Op::Contains:
+					if (!object)
+						frame.deferred.push_back(&check);
+					break;
+				case Op::DependentSchema:
+					if (object)
+						frame.deferred.push_back(&check);
+					break;
+				case Op::Enum:
+				case Op::AnyOf:
+				case Op::OneOf:
+				case Op::Not:
+				case Op::IfThenElse:
+					frame.deferred.push_back(&check);
+					break;
+				default:
+					break; // Checks of other types, $ref and allOf are expanded
+				}
+		// A key repeated in the text keeps its first value in the tree, later ones
+		// are neither counted nor checked (and slot() does not build them)
+		frame.tracksKeys = object && !frame.checks.empty();
+		if (!target && !frame.deferred.empty())
+			frame.owned.reset(new let), target = frame.owned.get();
+		if (target)
+		{
+			if (object)
+				target->getObject();
+			else
+				*target = Array();
+			frame.value = target;
+		}
+		return true;
+	}
+
+	inline bool Schema::Stream::onKey(const char* key, size_t length)
+	{
+		if (frames.empty() || !frames.back().object)
+			return true; // Unbalanced text, reported by the parser
+		Frame& frame = frames.back();
+		frame.key.assign(key, length);
+		frame.next.clear();
+		if (frame.tracksKeys && !frame.seen.insert(frame.key).second)
+			return true;
+		frame.count++;
+		Key name(frame.key.c_str(), frame.key.size());
+		for (const Check* check : frame.checks)
+			switch (check->op)
+			{
+			case Op::MaxProperties:
+				if (frame.count > check->number)
+					return reject(*check, frame.path());
+				break;
+			case Op::Properties:
+			{
+				const Members& table = schema.members[check->table];
+				bool matched = false;
+				size_t named = table.named.find(name);
+				if (named != npos)
+					matched = true, frame.next.push_back(table.named[named]);
+				if (!table.patterns.empty())
+				{
+					std::wstring wide = widen(name, length);
+					for (const std::pair<size_t, size_t>& pattern : table.patterns)
+						if (std::regex_search(wide, schema.regexes[pattern.first]))
+							matched = true, frame.next.push_back(pattern.second);
+				}
+				if (!matched && table.additional != npos)
+					frame.next.push_back(table.additional);
+				break;
+			}
+			case Op::PropertyNames:
+			{
+				let value;
+				value.setString(name, length);
+				Path at = { frame.path(), name, 0 };
+				if (!schema.validateNode(check->node, value, &at, reason))
+					return failed = true, false;
+				break;
+			}
+			default:
+				break;
+			}
+		return true;
+	}
+
+	inline bool Schema::Stream::close()
+	{
+		if (frames.empty())
+			return true; // Unbalanced text, reported by the parser
+		Frame& frame = frames.back();
+		for (const Check* check : frame.checks)
+			switch (check->op)
+			{
+			case Op::MinItems:
+			case Op::MinProperties:
+				if (frame.count < check->number)
+					return reject(*check, frame.path());
+				break;
+			case Op::Required:
+			case Op::DependentRequired:
+			{
+				size_t first = check->op == Op::Required ? 0 : 1;
+				if (first && !frame.seen.count(std::string(check->names[0].str, check->names[0].len)))
+					break;
+				for (size_t i = first; i < check->names.size(); i++)
+					if (!frame.seen.count(std::string(check->names[i].str, check->names[i].len)))
+						return reject(*check, frame.path());
+				break;
+			}
+			default:
+				break;
+			}
+		for (const Check* check : frame.deferred)
+			if (!schema.run(*check, *frame.value, frame.path(), reason))
+				return failed = true, false;
+		frames.pop_back();
+		return true;
+	}
+
+	inline bool Schema::validateNode(size_t node, const let& value, const Path* path, std::string* reason) const
+	{
+		for (const Check& check : nodes[node])
+			if (!run(check, value, path, reason))
+				return false;
+		return true;
+	}
+
+	inline bool Schema::run(const Check& check, const let& value, const Path* path, std::string* reason) const
+	{
+		unsigned type = typeOf(value);
+		switch (check.op)
+		{
+		case Op::False:
+			return reject(check, path, reason);
+		case Op::Type:
+			return (type & check.code) || reject(check, path, reason);
+		case Op::Enum:
+			return sets[check.table].count(canonical(value)) || reject(check, path, reason);
+		case Op::Minimum:
+			return !(type & typeNumber) || numberOf(value) >= check.number || reject(check, path, reason);
+		case Op::Maximum:
+			return !(type & typeNumber) || numberOf(value) <= check.number || reject(check, path, reason);
+		case Op::ExclusiveMinimum:
+			return !(type & typeNumber) || numberOf(value) > check.number || reject(check, path, reason);
+		case Op::ExclusiveMaximum:
+			return !(type & typeNumber) || numberOf(value) < check.number || reject(check, path, reason);
+		case Op::MultipleOf:
+		{
+			if (!(type & typeNumber) || check.number <= 0)
+				return true;
+			long double divisor = check.number;
+			if (value.idx == 2 && divisor == std::floor(divisor) && divisor < 9.2e18L)
+				return value._int % (long long)divisor == 0 || reject(check, path, reason);
+			double number = (double)numberOf(value), quotient = number / (double)divisor;
+			if (std::isinf(quotient))
+				return std::fmod(number, (double)divisor) == 0 || reject(check, path, reason);
+			return std::fabs(quotient - std::round(quotient)) <= std::max(1e-9, std::fabs(quotient) * 1e-15) ||
+				   reject(check, path, reason);
+		}
+		case Op::MinLength:
+			return !(type & typeString) || codePoints(value._str, value._len) >= check.number || reject(check, path, reason);
+		case Op::MaxLength:
+			return !(type & typeString) || codePoints(value._str, value._len) <= check.number || reject(check, path, reason);
+		case Op::Pattern:
+			return !(type & typeString) || std::regex_search(widen(value._str, value._len), regexes[check.table]) ||
+				   reject(check, path, reason);
+		case Op::Format:
+			return !(type & typeString) || checkFormat(check.code, value._str, value._len) || reject(check, path, reason);
+		case Op::Content:
+			return !(type & typeString) || checkContent(check.code, value._str, value._len) || reject(check, path, reason);
+		case Op::MinItems:
+			return !(type & typeArray) || value._array->size() >= check.number || reject(check, path, reason);
+		case Op::MaxItems:
+			return !(type & typeArray) || value._array->size() <= check.number || reject(check, path, reason);
+		case Op::UniqueItems:
+		{
+			if (!(type & typeArray))
+				return true;
+			std::unordered_set<std::string> seen;
+			for (const let& element : *value._array)
+				if (!seen.insert(canonical(element)).second)
+					return reject(check, path, reason);
+			return true;
+		}
+		case Op::Items:
+		case Op::TupleItems:
+		{
+			if (!(type & typeArray))
+				return true;
+			const Array& elements = *value._array;
+			for (size_t i = 0; i < elements.size(); i++)
+			{
+				size_t node = check.op == Op::Items ? check.node : i < check.nodes.size() ? check.nodes[i] : check.node;
+				if (node == npos)
+					break;
+				Path inner = { path, nullptr, i };
+				if (!validateNode(node, elements[i], &inner, reason))
+					return reject(check, &inner, reason);
+			}
+			return true;
+		}
+		case Op::Contains:
+			if (!(type & typeArray))
+				return true;
+			for (const let& element : *value._array)
+				if (validateNode(check.node, element, path, nullptr))
+					return true;
+			return reject(check, path, reason);
+		case Op::MinProperties:
+			return !(type & typeObject) || value._obj->values.Size() >= check.number || reject(check, path, reason);
+		case Op::MaxProperties:
+			return !(type & typeObject) || value._obj->values.Size() <= check.number || reject(check, path, reason);
+		case Op::Required:
+		case Op::DependentRequired:
+		case Op::DependentSchema:
+		{
+			if (!(type & typeObject))
+				return true;
+			const Map<Key, let>& entries = value._obj->values;
+			size_t first = check.op == Op::Required ? 0 : 1;
+			const Key& trigger = check.names[0];
+			if (first && entries.find(trigger) == npos)
+				return true;
+			if (check.op == Op::DependentSchema)
+				return validateNode(check.node, value, path, reason) || reject(check, path, reason);
+			for (size_t i = first; i < check.names.size(); i++)
+			{
+				if (entries.find(check.names[i]) == npos)
+					return reject(check, path, reason);
+			}
+			return true;
+		}
+		case Op::Properties:
+		{
+			if (!(type & typeObject))
+				return true;
+			const Members& table = members[check.table];
+			const Map<Key, let>& entries = value._obj->values;
+			for (size_t i = 0; i < entries.Size(); i++)
+			{
+				Key key = entries.getId(i);
+				Path inner = { path, key, 0 };
+				bool matched = false;
+				size_t named = table.named.find(key);
+				if (named != npos)
+				{
+					matched = true;
+					if (!validateNode(table.named[named], entries[i], &inner, reason))
+						return reject(check, &inner, reason);
+				}
+				if (!table.patterns.empty())
+				{
+					std::wstring name = widen(key.str, key.len);
+					for (const std::pair<size_t, size_t>& pattern : table.patterns)
+						if (std::regex_search(name, regexes[pattern.first]))
+						{
+							matched = true;
+							if (!validateNode(pattern.second, entries[i], &inner, reason))
+								return reject(check, &inner, reason);
+						}
+				}
+				if (!matched && table.additional != npos && !validateNode(table.additional, entries[i], &inner, reason))
+					return reject(check, &inner, reason);
+			}
+			return true;
+		}
+		case Op::PropertyNames:
+		{
+			if (!(type & typeObject))
+				return true;
+			const Map<Key, let>& entries = value._obj->values;
+			for (size_t i = 0; i < entries.Size(); i++)
+			{
+				Key key = entries.getId(i);
+				let name;
+				name.setString(key.str, key.len);
+				Path inner = { path, key, 0 };
+				if (!validateNode(check.node, name, &inner, reason))
+					return reject(check, &inner, reason);
+			}
+			return true;
+		}
+		case Op::AllOf:
+			for (size_t node : check.nodes)
+				if (!validateNode(node, value, path, reason))
+					return reject(check, path, reason);
+			return true;
+		case Op::AnyOf:
+			for (size_t node : check.nodes)
+				if (validateNode(node, value, path, nullptr))
+					return true;
+			return reject(check, path, reason);
+		case Op::OneOf:
+		{
+			size_t matches = 0;
+			for (size_t node : check.nodes)
+				if (validateNode(node, value, path, nullptr) && ++matches > 1)
+					break;
+			return matches == 1 || reject(check, path, reason);
+		}
+		case Op::Not:
+			return !validateNode(check.node, value, path, nullptr) || reject(check, path, reason);
+		case Op::IfThenElse:
+		{
+			size_t node = validateNode(check.node, value, path, nullptr) ? check.then : check.otherwise;
+			return node == npos || validateNode(node, value, path, reason) || reject(check, path, reason);
+		}
+		case Op::Ref:
+			return validateNode(check.node, value, path, reason);
+		}
+		return true;
+	}
+
+	inline bool Schema::reject(const Check& check, const Path* path, std::string* reason)
+	{
+		if (reason && reason->empty())
+			*reason = std::string(keywordOf(check.op)) + " at " + (path ? pointerOf(path) : "the root");
+		return false;
+	}
+
+	inline const char* Schema::keywordOf(Op op)
+	{
+		static const char* const names[] = {
+			"false", "type", "enum", "minimum", "maximum", "exclusiveMinimum", "exclusiveMaximum", "multipleOf",
+			"minLength", "maxLength", "pattern", "format", "content", "minItems", "maxItems", "uniqueItems",
+			"items", "items", "contains", "minProperties", "maxProperties", "required", "properties", "propertyNames",
+			"dependencies", "dependencies", "allOf", "anyOf", "oneOf", "not", "if", "$ref"
+		};
+		return names[(unsigned)op];
+	}
+
+	inline std::string Schema::pointerOf(const Path* path)
+	{
+		if (!path)
+			return std::string();
+		std::string pointer = pointerOf(path->parent) + '/';
+		if (!path->key.str)
+			return pointer + std::to_string(path->index);
+		for (size_t i = 0; i < path->key.len; i++)
+		{
+			char c = path->key.str[i];
+			pointer += c == '~' ? "~0" : c == '/' ? "~1" : std::string(1, c);
+		}
+		return pointer;
+	}
+
+	inline bool Schema::checkFormat(unsigned format, const char* str, size_t len) const
+	{
+		switch (format)
+		{
+		case formatDateTime:
+			return isDateTime(str, len);
+		case formatDate:
+			return isDate(str, len);
+		case formatTime:
+			return isTime(str, len);
+		case formatEmail:
+		case formatIdnEmail:
+			return isEmail(str, len, format == formatIdnEmail);
+		case formatHostname:
+			return isHostname(str, len);
+		case formatIdnHostname:
+			return isIdnHostname(str, len);
+		case formatIpv4:
+			return isIpv4(str, len);
+		case formatIpv6:
+			return isIpv6(str, len);
+		case formatUri:
+		case formatUriReference:
+		case formatIri:
+		case formatIriReference:
+			return isUri(str, len, format == formatIri || format == formatIriReference,
+						 format == formatUriReference || format == formatIriReference);
+		case formatUriTemplate:
+			return isUriTemplate(str, len);
+		case formatJsonPointer:
+			return isJsonPointer(str, len);
+		case formatRelativeJsonPointer:
+			return isRelativeJsonPointer(str, len);
+		case formatRegex:
+			try
+			{
+				std::wregex(translateRegex(widen(str, len)), std::regex::ECMAScript);
+				return true;
+			}
+			catch (const std::regex_error&)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	inline bool Schema::checkContent(unsigned content, const char* str, size_t len) const
+	{
+		std::string decoded;
+		if ((content & contentBase64) && !decodeBase64(str, len, &decoded))
+			return false;
+		if (!(content & contentJson))
+			return true;
+		JSON reader;
+		reader.parseText(content & contentBase64 ? decoded.c_str() : std::string(str, len).c_str());
+		return reader.isValid();
+	}
+
+	inline const let* Schema::member(const let& object, const char* key)
+	{
+		if (object.index() != 6)
+			return nullptr;
+		const Map<Key, let>& entries = object._obj->values;
+		size_t position = entries.find(key);
+		return position == npos ? nullptr : &entries[position];
+	}
+
+	inline unsigned Schema::typeOf(const let& value)
+	{
+		switch (value.index())
+		{
+		case 0:
+			return typeString;
+		case 1:
+			return typeBoolean;
+		case 2:
+			return typeNumber | typeInteger;
+		case 3:
+		case 4:
+		{
+			long double number = numberOf(value);
+			return std::isfinite(number) && number == std::floor(number) ? typeNumber | typeInteger : typeNumber;
+		}
+		case 5:
+			return typeArray;
+		case 6:
+			return typeObject;
+		default:
+			return typeNull;
+		}
+	}
+
+	inline long double Schema::numberOf(const let& value)
+	{
+		return value.idx == 2 ? (long double)value._int : value.idx == 3 ? value._float : value.idx == 4 ? value._double : 0;
+	}
+
+	inline std::string Schema::canonical(const let& value)
+	{
+		std::string out;
+		canonical(value, out);
+		return out;
+	}
+
+	inline void Schema::canonical(const let& value, std::string& out)
+	{
+		switch (value.index())
+		{
+		case 0:
+			out += 's' + std::to_string(value._len) + ':';
+			out.append(value._str, value._len);
+			break;
+		case 1:
+			out += value._bool ? 't' : 'f';
+			break;
+		case 2:
+		case 3:
+		case 4:
+		{
+			// Equal numbers have one text, whatever their storage: 1, 1.0 and 1e0 are all "n1;"
+			long double number = numberOf(value);
+			char text[40];
+			if (number == std::floor(number) && std::fabs(number) < 9.2e18L)
+				snprintf(text, sizeof(text), "n%lld;", (long long)number);
+			else
+				snprintf(text, sizeof(text), "n%.17g;", (double)number);
+			out += text;
+			break;
+		}
+		case 5:
+		{
+			out += 'a' + std::to_string(value._array->size()) + '[';
+			for (const let& element : *value._array)
+				canonical(element, out);
+			out += ']';
+			break;
+		}
+		case 6:
+		{
+			// Members are sorted by key, so the order of the text does not matter
+			const Map<Key, let>& entries = value._obj->values;
+			std::vector<std::pair<std::string, size_t>> sorted;
+			for (size_t i = 0; i < entries.Size(); i++)
+			{
+				Key key = entries.getId(i);
+				sorted.emplace_back(std::string(key.str, key.len), i);
+			}
+			std::sort(sorted.begin(), sorted.end());
+			out += 'o' + std::to_string(sorted.size()) + '{';
+			for (const std::pair<std::string, size_t>& entry : sorted)
+			{
+				out += 'k' + std::to_string(entry.first.size()) + ':' + entry.first;
+				canonical(entries[entry.second], out);
+			}
+			out += '}';
+			break;
+		}
+		default:
+			out += 'z';
+		}
+	}
+
+	inline size_t Schema::codePoints(const char* str, size_t len)
+	{
+		size_t count = 0;
+		for (size_t i = 0; i < len; i++)
+			count += ((unsigned char)str[i] & 0xC0) != 0x80;
+		return count;
+	}
+
+	inline std::u32string Schema::decodeUtf8(const char* str, size_t len)
+	{
+		std::u32string out;
+		for (size_t i = 0; i < len;)
+		{
+			unsigned char c = (unsigned char)str[i];
+			size_t extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+			char32_t point = extra == 3 ? c & 0x07 : extra == 2 ? c & 0x0F : extra == 1 ? c & 0x1F : c;
+			for (i++; extra && i < len; extra--, i++)
+				point = (point << 6) | ((unsigned char)str[i] & 0x3F);
+			out += point;
+		}
+		return out;
+	}
+
+	inline std::wstring Schema::widen(const char* str, size_t len)
+	{
+		std::u32string points = decodeUtf8(str, len);
+		return std::wstring(points.begin(), points.end());
+	}
+
+	inline std::wstring Schema::translateRegex(const std::wstring& pattern)
+	{
+		// ECMA 262 classes, std::regex follows the locale instead
+		static const wchar_t spaces[] = L" \t\n\v\f\r\u00a0\u1680\u2000-\u200a\u2028\u2029\u202f\u205f\u3000\ufeff";
+		std::wstring out;
+		bool inClass = false;
+		for (size_t i = 0; i < pattern.size(); i++)
+		{
+			wchar_t c = pattern[i];
+			if (c != L'\\' || i + 1 == pattern.size())
+			{
+				if (c == L'[')
+					inClass = true;
+				else if (c == L']')
+					inClass = false;
+				out += c;
+				continue;
+			}
+			wchar_t next = pattern[++i];
+			if (next == L'c' && i + 1 < pattern.size() && iswalpha(pattern[i + 1]) && pattern[i + 1] < 0x80)
+			{
+				// Control character \cX, not known to std::regex
+				out += L"\\x", out += L"0123456789abcdef"[(pattern[i + 1] % 32) >> 4], out += L"0123456789abcdef"[pattern[i + 1] % 16];
+				i++;
+				continue;
+			}
+			const wchar_t* members = next == L'd' || next == L'D' ? L"0-9" : next == L'w' || next == L'W' ? L"A-Za-z0-9_" : next == L's' || next == L'S' ? spaces : nullptr;
+			bool negated = next == L'D' || next == L'W' || next == L'S';
+			if (!members || (inClass && negated))
+				out += c, out += next;
+			else if (inClass)
+				out += members;
+			else
+				out += negated ? L"[^" : L"[", out += members, out += L']';
+		}
+		return out;
+	}
+
+	inline Schema::Uri Schema::parseUri(const std::string& text)
+	{
+		Uri uri;
+		size_t i = 0;
+		size_t colon = text.find_first_of(":/?#");
+		if (colon != std::string::npos && colon > 0 && text[colon] == ':' && isalpha((unsigned char)text[0]))
+			uri.scheme = text.substr(0, colon), uri.hasScheme = true, i = colon + 1;
+		if (text.compare(i, 2, "//") == 0)
+		{
+			size_t end = std::min(text.find_first_of("/?#", i + 2), text.size());
+			uri.authority = text.substr(i + 2, end - i - 2), uri.hasAuthority = true, i = end;
+		}
+		size_t end = std::min(text.find_first_of("?#", i), text.size());
+		uri.path = text.substr(i, end - i), i = end;
+		if (i < text.size() && text[i] == '?')
+		{
+			end = std::min(text.find('#', i), text.size());
+			uri.query = text.substr(i + 1, end - i - 1), uri.hasQuery = true, i = end;
+		}
+		if (i < text.size())
+			uri.fragment = text.substr(i + 1), uri.hasFragment = true;
+		return uri;
+	}
+
+	inline std::string Schema::removeDotSegments(const std::string& path)
+	{
+		std::string input = path, output;
+		while (!input.empty())
+		{
+			if (input.compare(0, 3, "../") == 0)
+				input.erase(0, 3);
+			else if (input.compare(0, 2, "./") == 0 || input.compare(0, 3, "/./") == 0)
+				input.erase(0, 2);
+			else if (input == "/.")
+				input = "/";
+			else if (input.compare(0, 4, "/../") == 0 || input == "/..")
+			{
+				input = input.size() == 3 ? "/" : input.substr(3);
+				size_t last = output.rfind('/');
+				output.erase(last == std::string::npos ? 0 : last);
+			}
+			else if (input == "." || input == "..")
+				input.clear();
+			else
+			{
+				size_t next = input.find('/', input[0] == '/' ? 1 : 0);
+				output += input.substr(0, next);
+				input.erase(0, next == std::string::npos ? input.size() : next);
+			}
+		}
+		return output;
+	}
+
+	inline std::string Schema::resolveUri(const std::string& base, const std::string& ref)
+	{
+		// RFC 3986, section 5.2
+		Uri b = parseUri(base), r = parseUri(ref), t;
+		if (r.hasScheme)
+			t = r, t.path = removeDotSegments(r.path);
+		else
+		{
+			if (r.hasAuthority)
+				t.authority = r.authority, t.hasAuthority = true, t.path = removeDotSegments(r.path), t.query = r.query,
+				t.hasQuery = r.hasQuery;
+			else
+			{
+				if (r.path.empty())
+					t.path = b.path, t.query = r.hasQuery ? r.query : b.query, t.hasQuery = r.hasQuery || b.hasQuery;
+				else
+				{
+					if (r.path[0] == '/')
+						t.path = removeDotSegments(r.path);
+					else if (b.hasAuthority && b.path.empty())
+						t.path = removeDotSegments("/" + r.path);
+					else
+					{
+						size_t slash = b.path.rfind('/');
+						t.path = removeDotSegments((slash == std::string::npos ? "" : b.path.substr(0, slash + 1)) + r.path);
+					}
+					t.query = r.query, t.hasQuery = r.hasQuery;
+				}
+				t.authority = b.authority, t.hasAuthority = b.hasAuthority;
+			}
+			t.scheme = b.scheme, t.hasScheme = b.hasScheme;
+		}
+		t.fragment = r.fragment, t.hasFragment = r.hasFragment;
+		std::string out;
+		if (t.hasScheme)
+			out += t.scheme + ':';
+		if (t.hasAuthority)
+			out += "//" + t.authority;
+		out += t.path;
+		if (t.hasQuery)
+			out += '?' + t.query;
+		if (t.hasFragment && !t.fragment.empty())
+			out += '#' + t.fragment;
+		return out;
+	}
+
+	inline std::string Schema::withoutFragment(const std::string& uri)
+	{
+		return uri.substr(0, uri.find('#'));
+	}
+
+	inline bool Schema::decodeBase64(const char* str, size_t len, std::string* out)
+	{
+		if (len % 4)
+			return false;
+		unsigned bits = 0, count = 0;
+		for (size_t i = 0; i < len; i++)
+		{
+			char c = str[i];
+			int value = c >= 'A' && c <= 'Z' ? c - 'A' : c >= 'a' && c <= 'z' ? c - 'a' + 26 : c >= '0' && c <= '9' ? c - '0' + 52 : c == '+' ? 62 : c == '/' ? 63 : -1;
+			if (c == '=')
+			{
+				// Padding only ends the text
+				if (i + 2 < len || (i + 1 < len && str[i + 1] != '='))
+					return false;
+				continue;
+			}
+			if (value < 0)
+				return false;
+			bits = (bits << 6) | (unsigned)value, count += 6;
+			if (count >= 8)
+				count -= 8, *out += (char)((bits >> count) & 0xFF);
+		}
+		return true;
+	}
+
+	inline bool Schema::digits(const char* str, size_t len)
+	{
+		for (size_t i = 0; i < len; i++)
+			if (str[i] < '0' || str[i] > '9')
+				return false;
+		return true;
+	}
+
+	inline bool Schema::isDate(const char* str, size_t len)
+	{
+		static const int days[] = { 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+		if (len != 10 || !digits(str, 4) || str[4] != '-' || !digits(str + 5, 2) || str[7] != '-' || !digits(str + 8, 2))
+			return false;
+		int year = atoi(std::string(str, 4).c_str()), month = twoDigits(str + 5), day = twoDigits(str + 8);
+		if (month < 1 || month > 12 || day < 1 || day > days[month - 1])
+			return false;
+		return month != 2 || day < 29 || (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0));
+	}
+
+	inline bool Schema::isTime(const char* str, size_t len)
+	{
+		// HH:MM:SS[.fraction](Z|+HH:MM|-HH:MM)
+		if (len < 9 || !digits(str, 2) || str[2] != ':' || !digits(str + 3, 2) || str[5] != ':' || !digits(str + 6, 2))
+			return false;
+		int hour = twoDigits(str), minute = twoDigits(str + 3), second = twoDigits(str + 6);
+		size_t i = 8;
+		if (str[i] == '.')
+		{
+			size_t start = ++i;
+			while (i < len && str[i] >= '0' && str[i] <= '9')
+				i++;
+			if (i == start)
+				return false;
+		}
+		int offset = 0;
+		if (i + 1 == len && (str[i] == 'Z' || str[i] == 'z'))
+			offset = 0;
+		else if (i + 6 == len && (str[i] == '+' || str[i] == '-') && digits(str + i + 1, 2) && str[i + 3] == ':' && digits(str + i + 4, 2))
+		{
+			int hours = twoDigits(str + i + 1), minutes = twoDigits(str + i + 4);
+			if (hours > 23 || minutes > 59)
+				return false;
+			offset = (str[i] == '+' ? 1 : -1) * (hours * 60 + minutes);
+		}
+		else
+			return false;
+		if (hour > 23 || minute > 59 || second > 60)
+			return false;
+		// A leap second is the last second of a day in UTC
+		return second < 60 || ((hour * 60 + minute - offset) % 1440 + 1440) % 1440 == 23 * 60 + 59;
+	}
+
+	inline bool Schema::isDateTime(const char* str, size_t len)
+	{
+		return len > 11 && isDate(str, 10) && (str[10] == 'T' || str[10] == 't') && isTime(str + 11, len - 11);
+	}
+
+	inline bool Schema::isEmail(const char* str, size_t len, bool international)
+	{
+		const char* at = (const char*)memchr(str, '@', len);
+		if (!at || at == str || at + 1 == str + len || memchr(at + 1, '@', str + len - at - 1))
+			return false;
+		size_t local = at - str;
+		if (str[0] == '.' || str[local - 1] == '.')
+			return false;
+		for (size_t i = 0; i < local; i++)
+		{
+			unsigned char c = (unsigned char)str[i];
+			if ((c == '.' && str[i + 1] == '.') || (c >= 0x80 && !international) || c <= ' ' || strchr("\"(),:;<>[\\]", c))
+				return false;
+		}
+		const char* domain = at + 1;
+		size_t length = str + len - domain;
+		if (domain[0] == '[' && domain[length - 1] == ']')
+			return length > 2 && (isIpv4(domain + 1, length - 2) || (length > 7 && !strncmp(domain + 1, "IPv6:", 5) && isIpv6(domain + 6, length - 7)));
+		return international ? isIdnHostname(domain, length) : isHostname(domain, length);
+	}
+
+	inline bool Schema::isHostname(const char* str, size_t len)
+	{
+		if (len && str[len - 1] == '.')
+			len--;
+		if (len == 0 || len > 253)
+			return false;
+		size_t start = 0;
+		for (size_t i = 0; i <= len; i++)
+		{
+			if (i < len && str[i] != '.')
+			{
+				if (!isalnum((unsigned char)str[i]) && str[i] != '-')
+					return false;
+				continue;
+			}
+			if (i == start || i - start > 63 || str[start] == '-' || str[i - 1] == '-')
+				return false;
+			start = i + 1;
+		}
+		return true;
+	}
+
+	inline bool Schema::isIdnHostname(const char* str, size_t len)
+	{
+		std::u32string text = decodeUtf8(str, len);
+		if (text.empty())
+			return false;
+		std::u32string label;
+		size_t total = 0;
+		for (size_t i = 0; i <= text.size(); i++)
+		{
+			char32_t c = i < text.size() ? text[i] : U'.';
+			if (c != U'.' && c != 0x3002 && c != 0xFF0E && c != 0xFF61)
+			{
+				label += c;
+				continue;
+			}
+			if (label.empty() && i == text.size() && i > 0)
+				break; // Trailing dot
+			if (!isIdnLabel(label))
+				return false;
+			total += label.size() + 1, label.clear();
+		}
+		return total <= 254;
+	}
+
+	inline bool Schema::isIdnLabel(const std::u32string& label)
+	{
+		if (label.empty())
+			return false;
+		bool ascii = true;
+		for (char32_t c : label)
+			ascii = ascii && c < 0x80;
+		std::u32string text = label;
+		if (ascii && label.size() > 4 && (label[0] | 0x20) == 'x' && (label[1] | 0x20) == 'n' && label[2] == '-' && label[3] == '-')
+		{
+			text.clear();
+			if (label.size() > 63 || !punycodeDecode(std::string(label.begin() + 4, label.end()), text) || text.empty())
+				return false;
+		}
+		else if (ascii ? label.size() > 63 : 4 + punycodeLength(label) > 63)
+			return false;
+		if (text[0] == '-' || text.back() == '-' || (text.size() >= 4 && text[2] == '-' && text[3] == '-'))
+			return false;
+		// Combining marks cannot start a label (RFC 5891, 4.2.3.2)
+		static const char32_t marks[][2] = { { 0x0300, 0x036F }, { 0x0483, 0x0489 }, { 0x0591, 0x05BD }, { 0x0610, 0x061A },
+											 { 0x064B, 0x065F }, { 0x0900, 0x0903 }, { 0x093A, 0x094F }, { 0x0981, 0x0983 },
+											 { 0x1AB0, 0x1AFF }, { 0x1DC0, 0x1DFF }, { 0x20D0, 0x20FF }, { 0xFE20, 0xFE2F } };
+		for (const char32_t* range : marks)
+			if (text[0] >= range[0] && text[0] <= range[1])
+				return false;
+		static const char32_t viramas[] = { 0x094D, 0x09CD, 0x0A4D, 0x0ACD, 0x0B4D, 0x0BCD, 0x0C4D, 0x0CCD, 0x0D4D, 0x0DCA, 0x0E3A, 0x0F84, 0x1039, 0x103A, 0x1714, 0x1734, 0x17D2 };
+		bool arabicDigits = false, extendedDigits = false, japanese = false, katakanaDot = false;
+		for (size_t i = 0; i < text.size(); i++)
+		{
+			char32_t c = text[i], before = i ? text[i - 1] : 0, after = i + 1 < text.size() ? text[i + 1] : 0;
+			if (c < 0x80)
+			{
+				if (!isalnum((int)c) && c != '-')
+					return false;
+				continue;
+			}
+			switch (c)
+			{
+			// DISALLOWED exceptions of RFC 5892, 2.6
+			case 0x0640:
+			case 0x07FA:
+			case 0x302E:
+			case 0x302F:
+			case 0x3031:
+			case 0x3032:
+			case 0x3033:
+			case 0x3034:
+			case 0x3035:
+			case 0x303B:
+				return false;
+			// Contextual rules of RFC 5892, appendix A
+			case 0x00B7:
+				if (before != 'l' || after != 'l')
+					return false;
+				break;
+			case 0x0375:
+				if (!((after >= 0x0370 && after <= 0x03FF) || (after >= 0x1F00 && after <= 0x1FFF)))
+					return false;
+				break;
+			case 0x05F3:
+			case 0x05F4:
+				if (before < 0x0590 || before > 0x05FF)
+					return false;
+				break;
+			case 0x200D:
+				if (std::find(std::begin(viramas), std::end(viramas), before) == std::end(viramas))
+					return false;
+				break;
+			case 0x200C:
+				if (std::find(std::begin(viramas), std::end(viramas), before) == std::end(viramas) &&
+					!(before >= 0x0620 && before <= 0x06FF && after >= 0x0620 && after <= 0x06FF))
+					return false;
+				break;
+			case 0x30FB:
+				katakanaDot = true;
+				break;
+			default:
+				if (c >= 0x0660 && c <= 0x0669)
+					arabicDigits = true;
+				else if (c >= 0x06F0 && c <= 0x06F9)
+					extendedDigits = true;
+				else if ((c >= 0x3040 && c <= 0x30FF) || (c >= 0x3400 && c <= 0x4DBF) || (c >= 0x4E00 && c <= 0x9FFF))
+					japanese = true;
+				else if ((c >= 0x2000 && c <= 0x200B) || (c >= 0x2028 && c <= 0x202F) || c == 0x3000 || c == 0xFEFF)
+					return false;
+			}
+		}
+		return !(arabicDigits && extendedDigits) && (!katakanaDot || japanese);
+	}
+
+	inline bool Schema::isIpv4(const char* str, size_t len)
+	{
+		size_t start = 0, parts = 0;
+		for (size_t i = 0; i <= len; i++)
+		{
+			if (i < len && str[i] != '.')
+				continue;
+			size_t length = i - start;
+			if (length == 0 || length > 3 || !digits(str + start, length) || (length > 1 && str[start] == '0') ||
+				atoi(std::string(str + start, length).c_str()) > 255)
+				return false;
+			parts++, start = i + 1;
+		}
+		return parts == 4;
+	}
+
+	inline bool Schema::isIpv6(const char* str, size_t len)
+	{
+		std::string text(str, len);
+		size_t gap = text.find("::");
+		if (gap != std::string::npos && text.find("::", gap + 1) != std::string::npos)
+			return false;
+		// Counts the groups of one side of the gap, the last one may be an IPv4 address
+		struct Groups
+		{
+			static bool count(const std::string& part, bool last, size_t& groups)
+			{
+				groups = 0;
+				if (part.empty())
+					return true;
+				for (size_t start = 0; start <= part.size();)
+				{
+					size_t end = std::min(part.find(':', start), part.size());
+					size_t length = end - start;
+					if (last && end == part.size() && part.find('.', start) != std::string::npos)
+					{
+						if (!isIpv4(part.data() + start, length))
+							return false;
+						groups += 2;
+					}
+					else
+					{
+						if (length == 0 || length > 4)
+							return false;
+						for (size_t i = start; i < end; i++)
+							if (!isxdigit((unsigned char)part[i]))
+								return false;
+						groups++;
+					}
+					start = end + 1;
+				}
+				return true;
+			}
+		};
+		size_t left = 0, right = 0;
+		if (gap == std::string::npos)
+			return Groups::count(text, true, left) && left == 8;
+		return Groups::count(text.substr(0, gap), false, left) && Groups::count(text.substr(gap + 2), true, right) && left + right <= 7;
+	}
+
+	inline bool Schema::isUri(const char* str, size_t len, bool international, bool reference)
+	{
+		std::string text(str, len);
+		for (size_t i = 0; i < len; i++)
+		{
+			unsigned char c = (unsigned char)text[i];
+			if (c >= 0x80 ? !international : (c <= ' ' || c == 0x7F || strchr("\"<>\\^`{|}", c)))
+				return false;
+			if (c == '%' && (i + 2 >= len || !isxdigit((unsigned char)text[i + 1]) || !isxdigit((unsigned char)text[i + 2])))
+				return false;
+		}
+		Uri uri = parseUri(text);
+		if (!uri.hasScheme && !reference)
+			return false;
+		for (char c : uri.scheme)
+			if (!isalnum((unsigned char)c) && c != '+' && c != '-' && c != '.')
+				return false;
+		if (!uri.hasScheme && !uri.hasAuthority && uri.path.find(':') < uri.path.find('/'))
+			return false; // The first segment of a relative path cannot have a colon
+		if (uri.fragment.find('#') != std::string::npos || uri.path.find_first_of("[]") != std::string::npos ||
+			uri.query.find_first_of("[]") != std::string::npos || uri.fragment.find_first_of("[]") != std::string::npos)
+			return false;
+		if (!uri.hasAuthority)
+			return true;
+		// authority: [userinfo@]host[:port]
+		std::string host = uri.authority.substr(uri.authority.rfind('@') == std::string::npos ? 0 : uri.authority.rfind('@') + 1);
+		size_t port = 0;
+		if (!host.empty() && host[0] == '[')
+		{
+			size_t close = host.find(']');
+			if (close == std::string::npos || !isIpv6(host.data() + 1, close - 1))
+				return false;
+			port = close + 1;
+			if (port < host.size() && host[port] != ':')
+				return false;
+		}
+		else
+		{
+			port = std::min(host.find(':'), host.size());
+			if (host.find_first_of("[]") != std::string::npos)
+				return false;
+		}
+		return port >= host.size() || digits(host.data() + port + 1, host.size() - port - 1);
+	}
+
+	inline bool Schema::isUriTemplate(const char* str, size_t len)
+	{
+		bool open = false;
+		for (size_t i = 0; i < len; i++)
+			if (str[i] == '{' || str[i] == '}')
+			{
+				if (open == (str[i] == '{'))
+					return false;
+				open = !open;
+			}
+		return !open;
+	}
+
+	inline bool Schema::isJsonPointer(const char* str, size_t len)
+	{
+		if (len && str[0] != '/')
+			return false;
+		for (size_t i = 0; i < len; i++)
+			if (str[i] == '~' && (i + 1 == len || (str[i + 1] != '0' && str[i + 1] != '1')))
+				return false;
+		return true;
+	}
+
+	inline bool Schema::isRelativeJsonPointer(const char* str, size_t len)
+	{
+		size_t i = 0;
+		while (i < len && str[i] >= '0' && str[i] <= '9')
+			i++;
+		if (i == 0 || (i > 1 && str[0] == '0'))
+			return false;
+		return (i + 1 == len && str[i] == '#') || isJsonPointer(str + i, len - i);
+	}
+
+	inline unsigned Schema::punycodeAdapt(unsigned long long delta, unsigned long long points, bool first)
+	{
+		delta = first ? delta / 700 : delta / 2;
+		delta += delta / points;
+		unsigned k = 0;
+		while (delta > ((36 - 1) * 26) / 2)
+			delta /= 36 - 1, k += 36;
+		return (unsigned)(k + (36 - 1 + 1) * delta / (delta + 38));
+	}
+
+	inline bool Schema::punycodeDecode(const std::string& text, std::u32string& out)
+	{
+		// RFC 3492, section 6.2
+		unsigned long long n = 128, i = 0;
+		unsigned bias = 72;
+		size_t delimiter = text.rfind('-'), position = 0;
+		if (delimiter != std::string::npos)
+		{
+			for (size_t j = 0; j < delimiter; j++)
+				out += (char32_t)(unsigned char)text[j];
+			position = delimiter + 1;
+		}
+		while (position < text.size())
+		{
+			unsigned long long old = i, w = 1;
+			for (unsigned k = 36;; k += 36)
+			{
+				if (position >= text.size())
+					return false;
+				char c = text[position++];
+				unsigned digit = c >= '0' && c <= '9' ? c - '0' + 26 : c >= 'a' && c <= 'z' ? c - 'a' : c >= 'A' && c <= 'Z' ? c - 'A' : 36;
+				if (digit >= 36)
+					return false;
+				i += digit * w;
+				unsigned t = k <= bias ? 1 : k >= bias + 26 ? 26 : k - bias;
+				if (digit < t)
+					break;
+				w *= 36 - t;
+				if (i > 0x10FFFFULL * 64 || w > 0x10FFFFULL * 64)
+					return false;
+			}
+			bias = punycodeAdapt(i - old, out.size() + 1, old == 0);
+			n += i / (out.size() + 1), i %= out.size() + 1;
+			if (n > 0x10FFFF)
+				return false;
+			out.insert(out.begin() + (size_t)i, (char32_t)n);
+			i++;
+		}
+		return true;
+	}
+
+	inline size_t Schema::punycodeLength(const std::u32string& label)
+	{
+		// RFC 3492, section 6.3, counting the characters instead of writing them
+		unsigned long long n = 128, delta = 0;
+		unsigned bias = 72;
+		size_t length = 0, handled = 0;
+		for (char32_t c : label)
+			if (c < 0x80)
+				length++, handled++;
+		size_t basic = handled;
+		if (basic)
+			length++;
+		while (handled < label.size())
+		{
+			unsigned long long next = 0x110000;
+			for (char32_t c : label)
+				if (c >= n && c < next)
+					next = c;
+			delta += (next - n) * (handled + 1), n = next;
+			for (char32_t c : label)
+			{
+				if (c < n)
+					delta++;
+				if (c != n)
+					continue;
+				unsigned long long q = delta;
+				for (unsigned k = 36;; k += 36)
+				{
+					unsigned t = k <= bias ? 1 : k >= bias + 26 ? 26 : k - bias;
+					if (q < t)
+						break;
+					length++, q = (q - t) / (36 - t);
+				}
+				length++;
+				bias = punycodeAdapt(delta, handled + 1, handled == basic);
+				delta = 0, handled++;
+			}
+			delta++, n++;
+		}
+		return length;
+	}
+
+	inline const char* Schema::metaschemaText()
+	{
+		// http://json-schema.org/draft-07/schema
+		return R"({
+	"$schema": "http://json-schema.org/draft-07/schema#",
+	"$id": "http://json-schema.org/draft-07/schema#",
+	"title": "Core schema meta-schema",
+	"definitions": {
+		"schemaArray": { "type": "array", "minItems": 1, "items": { "$ref": "#" } },
+		"nonNegativeInteger": { "type": "integer", "minimum": 0 },
+		"nonNegativeIntegerDefault0": { "allOf": [{ "$ref": "#/definitions/nonNegativeInteger" }, { "default": 0 }] },
+		"simpleTypes": { "enum": ["array", "boolean", "integer", "null", "number", "object", "string"] },
+		"stringArray": { "type": "array", "items": { "type": "string" }, "uniqueItems": true, "default": [] }
+	},
+	"type": ["object", "boolean"],
+	"properties": {
+		"$id": { "type": "string", "format": "uri-reference" },
+		"$schema": { "type": "string", "format": "uri" },
+		"$ref": { "type": "string", "format": "uri-reference" },
+		"$comment": { "type": "string" },
+		"title": { "type": "string" },
+		"description": { "type": "string" },
+		"default": true,
+		"readOnly": { "type": "boolean", "default": false },
+		"writeOnly": { "type": "boolean", "default": false },
+		"examples": { "type": "array", "items": true },
+		"multipleOf": { "type": "number", "exclusiveMinimum": 0 },
+		"maximum": { "type": "number" },
+		"exclusiveMaximum": { "type": "number" },
+		"minimum": { "type": "number" },
+		"exclusiveMinimum": { "type": "number" },
+		"maxLength": { "$ref": "#/definitions/nonNegativeInteger" },
+		"minLength": { "$ref": "#/definitions/nonNegativeIntegerDefault0" },
+		"pattern": { "type": "string", "format": "regex" },
+		"additionalItems": { "$ref": "#" },
+		"items": { "anyOf": [{ "$ref": "#" }, { "$ref": "#/definitions/schemaArray" }], "default": true },
+		"maxItems": { "$ref": "#/definitions/nonNegativeInteger" },
+		"minItems": { "$ref": "#/definitions/nonNegativeIntegerDefault0" },
+		"uniqueItems": { "type": "boolean", "default": false },
+		"contains": { "$ref": "#" },
+		"maxProperties": { "$ref": "#/definitions/nonNegativeInteger" },
+		"minProperties": { "$ref": "#/definitions/nonNegativeIntegerDefault0" },
+		"required": { "$ref": "#/definitions/stringArray" },
+		"additionalProperties": { "$ref": "#" },
+		"definitions": { "type": "object", "additionalProperties": { "$ref": "#" }, "default": {} },
+		"properties": { "type": "object", "additionalProperties": { "$ref": "#" }, "default": {} },
+		"patternProperties": { "type": "object", "additionalProperties": { "$ref": "#" }, "propertyNames": { "format": "regex" }, "default": {} },
+		"dependencies": { "type": "object", "additionalProperties": { "anyOf": [{ "$ref": "#" }, { "$ref": "#/definitions/stringArray" }] } },
+		"propertyNames": { "$ref": "#" },
+		"const": true,
+		"enum": { "type": "array", "items": true },
+		"type": { "anyOf": [{ "$ref": "#/definitions/simpleTypes" }, { "type": "array", "items": { "$ref": "#/definitions/simpleTypes" }, "minItems": 1, "uniqueItems": true }] },
+		"format": { "type": "string" },
+		"contentMediaType": { "type": "string" },
+		"contentEncoding": { "type": "string" },
+		"if": { "$ref": "#" },
+		"then": { "$ref": "#" },
+		"else": { "$ref": "#" },
+		"allOf": { "$ref": "#/definitions/schemaArray" },
+		"anyOf": { "$ref": "#/definitions/schemaArray" },
+		"oneOf": { "$ref": "#/definitions/schemaArray" },
+		"not": { "$ref": "#" }
+	},
+	"default": true
+})";
+	}
+}
+
+#endif
@@ -0,0 +1,564 @@
+/**
+ * @file JSONppSimd.h
+ * @brief Structural index, the first stage of JSON::Parse
+ *
+ * buildStructuralIndex reads the text in blocks of 64 characters and lists the
+ * position of every { } [ ] : , of every opening quote and of the first
+ * character of every number or literal, skipping whitespace and string
+ * contents. Characters are classified with AVX2 or SSE2 when the processor
+ * has them (chosen once at run time) and one by one otherwise; the quote and
+ * escape logic works on 64 bits masks and is shared by all of them.
+ *
+ * validateUtf8 checks UTF-8 with the lookup table algorithm of Keiser and
+ * Lemire when the processor has AVX2, and with a byte by byte decoder that
+ * skips ASCII words otherwise. The structural index runs it on the text chunk
+ * by chunk, right before indexing each chunk.
+ *
+ * findLineEnds splits JSON Lines texts into records with the same classifiers.
+ *
+ * findQuoteOrBackslash is the scanner of string contents used by
+ * JSON::ParseString: 32 characters at a time when built for AVX2, 16 with SSE2
+ * and 8 with plain 64 bits words otherwise.
+ *
+ * Define JSON_NO_SIMD to always use the portable code.
+ */
+
+#pragma once
+
+#ifndef _JSONPP_SIMD_
+#define _JSONPP_SIMD_
+
+#include <cstring>
+#include <vector>
+
+#if !defined(JSON_NO_SIMD) && (defined(__x86_64__) || defined(_M_X64))
+#define JSON_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(JSON_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define JSON_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define JSON_TARGET_AVX2
+#endif
+
+namespace json
+{
+	/** BlockMasks struct
+	 * @brief Classification of 64 characters, bit i describes character i
+	 */
+	struct BlockMasks
+	{
+		unsigned long long backslash; // '\'
+		unsigned long long quote;	  // '"'
+		unsigned long long op;		  // { } [ ] : ,
+		unsigned long long space;	  // ' ' '\t' '\n' '\r'
+		unsigned long long newline;	  // '\n'
+		unsigned long long special;	  // '/' and control characters other than whitespace
+	};
+
+	typedef void (*BlockClassifier)(const unsigned char* block, BlockMasks& masks);
+
+	// Number of trailing zero bits of a non zero value
+	inline int trailingZeros(unsigned long long value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		return __builtin_ctzll(value);
+#elif defined(_MSC_VER) && defined(_M_X64)
+		unsigned long n;
+		_BitScanForward64(&n, value);
+		return (int)n;
+#else
+		int n = 0;
+		while (!(value & 1))
+			value >>= 1, n++;
+		return n;
+#endif
+	}
+
+	// Portable classifier, one character at a time
+	inline void classifyScalar(const unsigned char* block, BlockMasks& masks)
+	{
+		masks = BlockMasks();
+		for (int i = 0; i < 64; i++)
+		{
+			unsigned long long bit = 1ULL << i;
+			switch (block[i])
+			{
+			case '\\':
+				masks.backslash |= bit;
+				break;
+			case '"':
+				masks.quote |= bit;
+				break;
+			case '{':
+			case '}':
+			case '[':
+			case ']':
+			case ':':
+			case ',':
+				masks.op |= bit;
+				break;
+			case '\n':
+				masks.newline |= bit;
+				masks.space |= bit;
+				break;
+			case ' ':
+			case '\t':
+			case '\r':
+				masks.space |= bit;
+				break;
+			case '/':
+				masks.special |= bit;
+				break;
+			default:
+				if (block[i] < 0x20)
+					masks.special |= bit;
+				break;
+			}
+		}
+	}
+
+#ifdef JSON_SIMD_X86
+	// SSE2 classifier, 16 characters at a time
+	inline void classifySSE2(const unsigned char* block, BlockMasks& masks)
+	{
+		const __m128i backslash = _mm_set1_epi8('\\'), quote = _mm_set1_epi8('"'), lower = _mm_set1_epi8(0x20),
+					  open = _mm_set1_epi8('{'), close = _mm_set1_epi8('}'), colon = _mm_set1_epi8(':'),
+					  comma = _mm_set1_epi8(','), tab = _mm_set1_epi8('\t'), lf = _mm_set1_epi8('\n'),
+					  cr = _mm_set1_epi8('\r'), slash = _mm_set1_epi8('/'), control = _mm_set1_epi8(0x1f);
+		masks = BlockMasks();
+		for (int i = 0; i < 4; i++)
+		{
+			__m128i c = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+			// '[' and ']' differ from '{' and '}' only in the 0x20 bit
+			__m128i folded = _mm_or_si128(c, lower);
+			__m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)),
+									  _mm_or_si128(_mm_cmpeq_epi8(c, colon), _mm_cmpeq_epi8(c, comma)));
+			__m128i newline = _mm_cmpeq_epi8(c, lf);
+			__m128i space = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, lower), _mm_cmpeq_epi8(c, tab)),
+										 _mm_or_si128(newline, _mm_cmpeq_epi8(c, cr)));
+			__m128i isControl = _mm_cmpeq_epi8(_mm_min_epu8(c, control), c);
+			__m128i special = _mm_or_si128(_mm_cmpeq_epi8(c, slash), _mm_andnot_si128(space, isControl));
+			int shift = 16 * i;
+			masks.backslash |= (unsigned long long)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(c, backslash)) << shift;
+			masks.quote |= (unsigned long long)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(c, quote)) << shift;
+			masks.op |= (unsigned long long)(unsigned)_mm_movemask_epi8(op) << shift;
+			masks.space |= (unsigned long long)(unsigned)_mm_movemask_epi8(space) << shift;
+			masks.newline |= (unsigned long long)(unsigned)_mm_movemask_epi8(newline) << shift;
+			masks.special |= (unsigned long long)(unsigned)_mm_movemask_epi8(special) << shift;
+		}
+	}
+
+	// AVX2 classifier, 32 characters at a time
+	JSON_TARGET_AVX2 inline void classifyAVX2(const unsigned char* block, BlockMasks& masks)
+	{
+		const __m256i backslash = _mm256_set1_epi8('\\'), quote = _mm256_set1_epi8('"'), lower = _mm256_set1_epi8(0x20),
+					  open = _mm256_set1_epi8('{'), close = _mm256_set1_epi8('}'), colon = _mm256_set1_epi8(':'),
+					  comma = _mm256_set1_epi8(','), tab = _mm256_set1_epi8('\t'), lf = _mm256_set1_epi8('\n'),
+					  cr = _mm256_set1_epi8('\r'), slash = _mm256_set1_epi8('/'), control = _mm256_set1_epi8(0x1f);
+		masks = BlockMasks();
+		for (int i = 0; i < 2; i++)
+		{
+			__m256i c = _mm256_loadu_si256((const __m256i*)(block + 32 * i));
+			__m256i folded = _mm256_or_si256(c, lower);
+			__m256i op = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(folded, open), _mm256_cmpeq_epi8(folded, close)),
+										 _mm256_or_si256(_mm256_cmpeq_epi8(c, colon), _mm256_cmpeq_epi8(c, comma)));
+			__m256i newline = _mm256_cmpeq_epi8(c, lf);
+			__m256i space = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(c, lower), _mm256_cmpeq_epi8(c, tab)),
+											_mm256_or_si256(newline, _mm256_cmpeq_epi8(c, cr)));
+			__m256i isControl = _mm256_cmpeq_epi8(_mm256_min_epu8(c, control), c);
+			__m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(c, slash), _mm256_andnot_si256(space, isControl));
+			int shift = 32 * i;
+			masks.backslash |= (unsigned long long)(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, backslash)) << shift;
+			masks.quote |= (unsigned long long)(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, quote)) << shift;
+			masks.op |= (unsigned long long)(unsigned)_mm256_movemask_epi8(op) << shift;
+			masks.space |= (unsigned long long)(unsigned)_mm256_movemask_epi8(space) << shift;
+			masks.newline |= (unsigned long long)(unsigned)_mm256_movemask_epi8(newline) << shift;
+			masks.special |= (unsigned long long)(unsigned)_mm256_movemask_epi8(special) << shift;
+		}
+	}
+
+	// True if the processor and the operating system support AVX2
+	inline bool hasAVX2()
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 1);
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		if (!osxsave || (_xgetbv(0) & 6) != 6)
+			return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2");
+#endif
+	}
+#endif
+
+	/** blockClassifier()
+	 * @brief Fastest classifier supported by the processor, detected on first use
+	 * @return Function that classifies 64 characters
+	 */
+	inline BlockClassifier blockClassifier()
+	{
+#ifdef JSON_SIMD_X86
+		static const BlockClassifier classifier = hasAVX2() ? classifyAVX2 : classifySSE2;
+		return classifier;
+#else
+		return classifyScalar;
+#endif
+	}
+
+	/** validUtf8Scalar()
+	 * @brief Byte by byte UTF-8 decoder
+	 * @param p Text
+	 * @param i Position to start at, the start of a sequence
+	 * @param length Characters of the text
+	 * @param truncated If not null, set to true when the text ends inside a sequence
+	 * @return Position of the first invalid sequence, or length
+	 */
+	inline size_t validUtf8Scalar(const unsigned char* p, size_t i, size_t length, bool* truncated)
+	{
+		while (i < length)
+		{
+			if (p[i] < 0x80)
+			{
+				unsigned long long word;
+				if (length - i >= 8 && (memcpy(&word, p + i, 8), !(word & 0x8080808080808080ULL)))
+					i += 8;
+				else
+					i++;
+				continue;
+			}
+			// Sequence length and range of the second byte, which rules out overlong
+			// forms, surrogates and code points above 0x10FFFF
+			unsigned char c = p[i], low = 0x80, high = 0xBF;
+			size_t n;
+			if (c >= 0xC2 && c <= 0xDF)
+				n = 1;
+			else if (c >= 0xE0 && c <= 0xEF)
+				n = 2, low = c == 0xE0 ? 0xA0 : 0x80, high = c == 0xED ? 0x9F : 0xBF;
+			else if (c >= 0xF0 && c <= 0xF4)
+				n = 3, low = c == 0xF0 ? 0x90 : 0x80, high = c == 0xF4 ? 0x8F : 0xBF;
+			else
+				return i;
+			for (size_t k = 1; k <= n; k++, low = 0x80, high = 0xBF)
+			{
+				if (i + k >= length)
+				{
+					if (truncated)
+						*truncated = true;
+					return i;
+				}
+				if (p[i + k] < low || p[i + k] > high)
+					return i;
+			}
+			i += n + 1;
+		}
+		return i;
+	}
+
+#ifdef JSON_SIMD_X86
+	/** validUtf8AVX2()
+	 * @brief Lookup table UTF-8 validation (Keiser and Lemire) of whole blocks of
+	 * 32 characters. Three 16 entries tables classify the high and low nibbles
+	 * of each byte and the high nibble of the next one; the and of the three is
+	 * the set of errors of the pair, and continuation bytes are counted apart
+	 * @param p Text
+	 * @param length Characters of the text
+	 * @return A position up to which the text is valid and that starts a
+	 * sequence; the rest is left to validUtf8Scalar
+	 */
+	JSON_TARGET_AVX2 inline size_t validUtf8AVX2(const unsigned char* p, size_t length)
+	{
+		// Error bits: 0x01 too short, 0x02 too long, 0x04 overlong 3 bytes, 0x08 too large,
+		// 0x10 surrogate, 0x20 overlong 2 bytes, 0x40 too large or overlong 4 bytes, 0x80 two continuations
+		static const unsigned char byte1High[16] = { 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02, 0x02,
+													 0x80, 0x80, 0x80, 0x80, 0x21, 0x01, 0x15, 0x49 };
+		static const unsigned char byte1Low[16] = { 0xE7, 0xA3, 0x83, 0x83, 0x8B, 0xCB, 0xCB, 0xCB,
+													0xCB, 0xCB, 0xCB, 0xCB, 0xCB, 0xDB, 0xCB, 0xCB };
+		static const unsigned char byte2High[16] = { 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01,
+													 0xE6, 0xAE, 0xBA, 0xBA, 0x01, 0x01, 0x01, 0x01 };
+		// Largest byte that does not start a sequence unfinished at the end of a block
+		static const unsigned char lastBytes[32] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+													 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+													 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF };
+		const __m256i tableByte1High = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)byte1High)),
+					  tableByte1Low = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)byte1Low)),
+					  tableByte2High = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)byte2High)),
+					  maxLast = _mm256_loadu_si256((const __m256i*)lastBytes), nibble = _mm256_set1_epi8(0x0F),
+					  third = _mm256_set1_epi8(0xE0 - 0x80), fourth = _mm256_set1_epi8(0xF0 - 0x80),
+					  high = _mm256_set1_epi8((char)0x80);
+		__m256i prev = _mm256_setzero_si256(), incomplete = _mm256_setzero_si256();
+		size_t i = 0;
+		for (; length - i >= 32; i += 32)
+		{
+			__m256i input = _mm256_loadu_si256((const __m256i*)(p + i));
+			if (!_mm256_movemask_epi8(input))
+			{
+				if (!_mm256_testz_si256(incomplete, incomplete))
+					break;
+				prev = input;
+				continue;
+			}
+			__m256i shifted = _mm256_permute2x128_si256(prev, input, 0x21);
+			__m256i prev1 = _mm256_alignr_epi8(input, shifted, 15), prev2 = _mm256_alignr_epi8(input, shifted, 14),
+					prev3 = _mm256_alignr_epi8(input, shifted, 13);
+			__m256i special = _mm256_and_si256(
+				_mm256_and_si256(_mm256_shuffle_epi8(tableByte1High, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+								 _mm256_shuffle_epi8(tableByte1Low, _mm256_and_si256(prev1, nibble))),
+				_mm256_shuffle_epi8(tableByte2High, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+			// Bytes two or three places after a lead of 3 or 4 bytes must be continuations
+			__m256i mustContinue = _mm256_and_si256(
+				_mm256_or_si256(_mm256_subs_epu8(prev2, third), _mm256_subs_epu8(prev3, fourth)), high);
+			__m256i error = _mm256_xor_si256(mustContinue, special);
+			if (!_mm256_testz_si256(error, error))
+				break;
+			incomplete = _mm256_subs_epu8(input, maxLast);
+			prev = input;
+		}
+		// The last sequence before i may be unfinished
+		size_t start = i;
+		while (start > 0 && i - start < 3 && (p[start - 1] & 0xC0) == 0x80)
+			start--;
+		if (start > 0 && p[start - 1] >= 0xC0)
+			start--;
+		return start;
+	}
+#endif
+
+	/** validateUtf8()
+	 * @brief Checks that a text is valid UTF-8
+	 * @param text Text to check
+	 * @param length Characters of the text
+	 * @param truncated If not null the text may end inside a sequence: this is
+	 * set to true then, and the result is the start of that sequence
+	 * @return Position of the first invalid sequence, or length if there is none
+	 */
+	inline size_t validateUtf8(const char* text, size_t length, bool* truncated = nullptr)
+	{
+		const unsigned char* p = (const unsigned char*)text;
+		size_t i = 0;
+#ifdef JSON_SIMD_X86
+		static const bool avx2 = hasAVX2();
+		if (avx2)
+			i = validUtf8AVX2(p, length);
+#endif
+		return validUtf8Scalar(p, i, length, truncated);
+	}
+
+	/** findQuoteOrBackslash()
+	 * @brief Finds the first '"' or '\\' of a range, used to skip the plain
+	 * characters of strings
+	 * @param p Start of the range
+	 * @param end End of the range, never read
+	 * @return Position of the character found, or end
+	 */
+	inline const char* findQuoteOrBackslash(const char* p, const char* end)
+	{
+#if defined(JSON_SIMD_X86) && defined(__AVX2__)
+		const __m256i quote32 = _mm256_set1_epi8('"'), backslash32 = _mm256_set1_epi8('\\');
+		for (; end - p >= 32; p += 32)
+		{
+			__m256i c = _mm256_loadu_si256((const __m256i*)p);
+			unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(c, quote32), _mm256_cmpeq_epi8(c, backslash32)));
+			if (mask)
+				return p + trailingZeros(mask);
+		}
+#endif
+#ifdef JSON_SIMD_X86
+		const __m128i quote = _mm_set1_epi8('"'), backslash = _mm_set1_epi8('\\');
+		for (; end - p >= 16; p += 16)
+		{
+			__m128i c = _mm_loadu_si128((const __m128i*)p);
+			unsigned mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(c, quote), _mm_cmpeq_epi8(c, backslash)));
+			if (mask)
+				return p + trailingZeros(mask);
+		}
+#else
+		// A byte of x is zero when (x - 0x01..) & ~x & 0x80.. has its high bit set
+		const unsigned long long ones = 0x0101010101010101ULL, highs = 0x8080808080808080ULL;
+		for (; end - p >= 8; p += 8)
+		{
+			unsigned long long word;
+			memcpy(&word, p, sizeof(word));
+			unsigned long long q = word ^ (ones * '"'), b = word ^ (ones * '\\');
+			if (((q - ones) & ~q & highs) | ((b - ones) & ~b & highs))
+				break;
+		}
+#endif
+		while (p < end && *p != '"' && *p != '\\')
+			p++;
+		return p;
+	}
+
+	/** StringScanner struct
+	 * @brief Quote and escape state of a text read in blocks of 64 characters
+	 */
+	struct StringScanner
+	{
+		unsigned long long prevEscaped = 0;	 // The first character of the next block is escaped
+		unsigned long long prevInString = 0; // All ones if the next block starts inside a string
+		/** inString()
+		 * @brief Characters of the next block that are inside strings: opening
+		 * quotes and contents, not closing quotes
+		 * @param masks Classification of the block
+		 * @param quote Receives the quotes of the block that are not escaped
+		 * @return Mask of the characters inside strings
+		 */
+		unsigned long long inString(const BlockMasks& masks, unsigned long long& quote)
+		{
+			// Characters escaped by a backslash
+			const unsigned long long evenBits = 0x5555555555555555ULL;
+			unsigned long long backslash = masks.backslash & ~prevEscaped;
+			unsigned long long followsEscape = backslash << 1 | prevEscaped;
+			unsigned long long oddStarts = backslash & ~evenBits & ~followsEscape;
+			unsigned long long evenSequences = oddStarts + backslash;
+			prevEscaped = evenSequences < backslash;
+			unsigned long long escaped = (evenBits ^ (evenSequences << 1)) & followsEscape;
+
+			quote = masks.quote & ~escaped;
+			unsigned long long inside = quote;
+			inside ^= inside << 1, inside ^= inside << 2, inside ^= inside << 4;
+			inside ^= inside << 8, inside ^= inside << 16, inside ^= inside << 32;
+			inside ^= prevInString;
+			prevInString = (unsigned long long)((long long)inside >> 63);
+			return inside;
+		}
+	};
+
+	/** buildStructuralIndex()
+	 * @brief Lists the positions the parser has to visit, see the file description.
+	 * A quote is escaped when an odd run of backslashes precedes it; string
+	 * contents are found with a prefix xor of the unescaped quotes. Scalars start
+	 * at the first non whitespace character that does not follow another one
+	 * @param buffer JSON text
+	 * @param length Characters of the text, the position length is appended as end mark
+	 * @param index Receives the positions in increasing order
+	 * @param invalidUtf8 If not null the text is also checked to be UTF-8: this
+	 * receives the position of the first invalid sequence, where indexing stops,
+	 * or length if there is none
+	 * @param classify Classifier to use
+	 * @return false if the text has comments or control characters outside of
+	 * strings, which only the character by character parser accepts
+	 */
+	inline bool buildStructuralIndex(const char* buffer, size_t length, std::vector<unsigned>& index,
+									 size_t* invalidUtf8 = nullptr, BlockClassifier classify = blockClassifier())
+	{
+		const size_t utf8Chunk = 16384; // Characters validated at once, small enough to stay in cache
+		size_t utf8Checked = 0,			// End of the validated chunks
+			utf8Resume = 0;				// Start of the next sequence to validate
+		if (invalidUtf8)
+			*invalidUtf8 = length;
+		StringScanner strings;
+		unsigned long long prevScalar = 0; // The next block follows a scalar character
+		size_t count = 0;
+		unsigned char tail[64];
+		BlockMasks masks;
+		for (size_t base = 0; base < length; base += 64)
+		{
+			if (invalidUtf8 && base >= utf8Checked)
+			{
+				size_t chunkEnd = length - base > utf8Chunk ? base + utf8Chunk : length;
+				bool truncated = false;
+				size_t valid = utf8Resume + validateUtf8(buffer + utf8Resume, chunkEnd - utf8Resume, &truncated);
+				if (valid < chunkEnd && !(truncated && chunkEnd < length))
+				{
+					*invalidUtf8 = valid;
+					index.resize(count);
+					return true;
+				}
+				utf8Resume = valid, utf8Checked = chunkEnd;
+			}
+			const unsigned char* block = (const unsigned char*)buffer + base;
+			if (length - base < 64)
+			{
+				// The last block is padded with whitespace, which marks nothing
+				memset(tail, ' ', sizeof(tail));
+				memcpy(tail, block, length - base);
+				block = tail;
+			}
+			classify(block, masks);
+
+			// Inside strings: opening quote and contents, not the closing quote
+			unsigned long long quote;
+			unsigned long long inString = strings.inString(masks, quote);
+			unsigned long long stringTail = inString ^ quote;
+
+			if (masks.special & ~(inString | quote))
+				return false;
+
+			// Scalars, the closing quote does not continue them
+			unsigned long long scalar = ~(masks.op | masks.space);
+			unsigned long long nonQuoteScalar = scalar & ~quote;
+			unsigned long long followsScalar = nonQuoteScalar << 1 | prevScalar;
+			prevScalar = nonQuoteScalar >> 63;
+			unsigned long long structural = (masks.op | (scalar & ~followsScalar)) & ~stringTail;
+
+			if (index.size() < count + 64)
+				index.resize(index.size() * 2 + 64);
+			unsigned* out = index.data() + count;
+			while (structural)
+			{
+				*out++ = (unsigned)(base + trailingZeros(structural));
+				structural &= structural - 1;
+			}
+			count = out - index.data();
+		}
+		if (index.size() < count + 1)
+			index.resize(count + 1);
+		index[count++] = (unsigned)length;
+		index.resize(count);
+		return true;
+	}
+
+	/** findLineEnds()
+	 * @brief Lists the newlines of a range of a text that are outside of
+	 * strings, the record ends of JSON Lines. Whether the range starts inside a
+	 * string depends on the text before it, so the newlines are listed for both
+	 * cases and ranges can be scanned at the same time
+	 * @param buffer Text
+	 * @param begin First character of the range
+	 * @param end End of the range
+	 * @param ends ends[0] receives the newlines found when the range starts
+	 * outside of strings, ends[1] when it starts inside one
+	 * @param classify Classifier to use
+	 * @return true if the range changes the state: when it starts outside of
+	 * strings it ends inside one
+	 */
+	inline bool findLineEnds(const char* buffer, size_t begin, size_t end, std::vector<size_t> ends[2],
+							 BlockClassifier classify = blockClassifier())
+	{
+		StringScanner strings;
+		// An odd run of backslashes right before the range escapes its first character
+		size_t run = 0;
+		while (run < begin && buffer[begin - run - 1] == '\\')
+			run++;
+		strings.prevEscaped = run & 1;
+		unsigned char tail[64];
+		BlockMasks masks;
+		for (size_t base = begin; base < end; base += 64)
+		{
+			const unsigned char* block = (const unsigned char*)buffer + base;
+			if (end - base < 64)
+			{
+				memset(tail, ' ', sizeof(tail));
+				memcpy(tail, block, end - base);
+				block = tail;
+			}
+			classify(block, masks);
+			unsigned long long quote;
+			unsigned long long inString = strings.inString(masks, quote);
+			for (int inside = 0; inside < 2; inside++)
+				for (unsigned long long newline = masks.newline & (inside ? inString : ~inString); newline; newline &= newline - 1)
+					ends[inside].push_back(base + trailingZeros(newline));
+		}
+		return strings.prevInString != 0;
+	}
+} // namespace json
+
+#endif
@@ -0,0 +1,72 @@
+/**
+ * @file check.h
+ * @brief Checks shared by the test programs of tests/. A check that does not
+ * hold prints its condition and line, and checkResult() gives exit code 1.
+ *
+ * Build: g++ tests/<name>.cpp -o <name>.out -std=c++11 -pthread
+ * Run:   ./<name>.out   (from the repository root)
+ */
+
+#pragma once
+
+#ifndef _JSONPP_CHECK_
+#define _JSONPP_CHECK_
+
+#include "../src/JSONpp.h"
+
+static size_t checksRun = 0;	// Checks evaluated so far
+static size_t checksFailed = 0; // Checks that did not hold
+
+// Evaluates a condition, printing it with its line when it does not hold
+#define CHECK(condition) checkThat((condition), #condition, __FILE__, __LINE__)
+
+inline bool checkThat(bool holds, const char* condition, const char* file, int line)
+{
+	checksRun++;
+	if (!holds)
+	{
+		checksFailed++;
+		std::cout << file << ":" << line << ": check failed: " << condition << std::endl;
+	}
+	return holds;
+}
+
+/** checkResult()
+ * @brief Prints the number of checks of a test program
+ * @param name Name of the program
+ * @return Exit code of the program, 1 if a check did not hold
+ */
+inline int checkResult(const char* name)
+{
+	std::cout << name << ": " << checksRun << " checks, " << checksFailed << " failed" << std::endl;
+	return checksFailed ? 1 : 0;
+}
+
+/** text()
+ * @brief Writes a value without spaces, see json::dump()
+ * @param value Value to write
+ * @return JSON text of the value
+ */
+inline String text(const json::let& value)
+{
+	String out;
+	json::dump(value, out);
+	return out;
+}
+
+/** parse()
+ * @brief Parses a text that stays with the caller through JSON::Parse, which
+ * releases the buffer it gets
+ * @param handler Handler that keeps the tree
+ * @param source JSON text
+ * @param flags Combination of ParseFlags, parseInSitu does not apply
+ * @return Root value of the document
+ */
+inline json::let& parse(json::JSON& handler, const String& source, unsigned flags = json::parseDefault)
+{
+	char* buffer = new char[source.size() + 1];
+	memcpy(buffer, source.c_str(), source.size() + 1);
+	return handler.Parse(buffer, flags & ~json::parseInSitu);
+}
+
+#endif
@@ -0,0 +1,157 @@
+/**
+ * @file draft7.cpp
+ * @brief Runs the draft-07 cases of the JSON Schema Test Suite against json::Schema.
+ *
+ * Build: g++ tests/draft7.cpp -o draft7.out -O2 -std=c++11
+ * Run:   ./draft7.out   (from the repository root)
+ *
+ * The suites are the draft7/ entries of tests/list.txt; other entries are not
+ * suites and are listed as skipped. Every group compiles its schema and checks
+ * that each case is accepted or rejected as the suite expects, and that
+ * Schema::validate on the parsed text of the case and Schema::validateText on
+ * the text itself agree. The documents refRemote.json loads from
+ * http://localhost:1234 are registered from the table below. Texts the suite
+ * does not have, as objects with repeated keys, are checked for the agreement
+ * only. Failed cases are printed and the exit code is 1 if there is any.
+ */
+
+#include "../src/JSONppSchema.h"
+#include <fstream>
+
+// Remote documents of the suite (remotes/ of the JSON Schema Test Suite) used by refRemote.json
+static const char* remotes[][2] = {
+	{ "http://localhost:1234/integer.json", "{\"type\":\"integer\"}" },
+	{ "http://localhost:1234/subSchemas.json",
+	  "{\"integer\":{\"type\":\"integer\"},\"refToInteger\":{\"$ref\":\"#/integer\"}}" },
+	{ "http://localhost:1234/baseUriChange/folderInteger.json", "{\"type\":\"integer\"}" },
+	{ "http://localhost:1234/baseUriChangeFolder/folderInteger.json", "{\"type\":\"integer\"}" },
+	{ "http://localhost:1234/baseUriChangeFolderInSubschema/folderInteger.json", "{\"type\":\"integer\"}" },
+	{ "http://localhost:1234/name.json",
+	  "{\"definitions\":{\"orNull\":{\"anyOf\":[{\"type\":\"null\"},{\"$ref\":\"#\"}]}},\"type\":\"string\"}" },
+};
+
+// Schemas and texts outside the suite, validate() and validateText() must agree on them
+static const char* agreement[][2] = {
+	{ "{\"maxProperties\":1}", "{\"a\":1,\"a\":2}" },
+	{ "{\"minProperties\":2}", "{\"a\":1,\"a\":2}" },
+	{ "{\"properties\":{\"a\":{\"type\":\"string\"}}}", "{\"a\":\"x\",\"a\":1}" },
+	{ "{\"properties\":{\"a\":{\"type\":\"string\"}}}", "{\"a\":1,\"a\":\"x\"}" },
+	{ "{\"additionalProperties\":{\"maxItems\":1}}", "{\"b\":[1],\"b\":[1,2]}" },
+	{ "{\"propertyNames\":{\"maxLength\":1},\"required\":[\"a\"]}", "{\"a\":{},\"a\":null}" },
+	{ "{\"enum\":[{\"a\":1}]}", "{\"a\":1,\"a\":2}" },
+	{ "{\"const\":{\"a\":2}}", "{\"a\":1,\"a\":2}" },
+	{ "{\"uniqueItems\":true}", "[{\"a\":1,\"a\":2},{\"a\":1}]" },
+	{ "{\"items\":{\"maxProperties\":1}}", "[{\"a\":{\"b\":1,\"b\":2},\"a\":3}]" },
+	{ "{\"not\":{\"properties\":{\"a\":{\"type\":\"integer\"}}}}", "{\"a\":\"x\",\"a\":1}" },
+};
+
+/** runAgreement()
+ * @brief Validates the texts of the agreement table through validate() and
+ * validateText()
+ * @param passed Incremented for every text with the same result from both
+ * @param failed Incremented for every other text, which is printed
+ */
+static void runAgreement(size_t& passed, size_t& failed)
+{
+	json::JSON instance;
+	for (auto& test : agreement)
+	{
+		json::Schema schema;
+		std::string reason, streamReason;
+		bool compiled = schema.compile(test[0]);
+		bool valid = compiled && schema.validate(instance.parseText(test[1]), &reason);
+		bool streamed = compiled && schema.validateText(test[1], &streamReason);
+		if (compiled && valid == streamed)
+		{
+			passed++;
+			continue;
+		}
+		failed++;
+		std::cout << "FAIL " << test[0] << " / " << test[1] << " (validate: " << (valid ? "valid" : reason)
+				  << ", validateText: " << (streamed ? "valid" : streamReason) << ")" << std::endl;
+	}
+}
+
+/** runSuite()
+ * @brief Compiles the schema of every group of a suite and validates its cases
+ * @param path Path of the suite file
+ * @param passed Incremented for every case with the expected result, the
+ * same from validate() and validateText()
+ * @param failed Incremented for every other case, which is printed
+ * @return false if the file cannot be read or parsed
+ */
+static bool runSuite(const std::string& path, size_t& passed, size_t& failed)
+{
+	char* text = readFile(path.c_str());
+	if (!text)
+		return false;
+	json::JSON reader, instance;
+	String data;
+	json::let& suite = reader.Parse(text); // Released by the parser
+	if (!reader.isValid() || suite.getType() != json::Type::Array)
+		return false;
+	for (size_t g = 0; g < suite.size(); g++)
+	{
+		json::let& group = suite[(int)g];
+		json::Schema schema;
+		for (auto& remote : remotes)
+			schema.addDocument(remote[0], remote[1]);
+		bool compiled = schema.compile(group["schema"]);
+		json::let& cases = group["tests"];
+		for (size_t t = 0; t < cases.size(); t++)
+		{
+			json::let& test = cases[(int)t];
+			data.clear();
+			json::dump(test["data"], data);
+			std::string reason = compiled ? "" : "schema not compiled: " + schema.getError(), streamReason;
+			bool valid = compiled && schema.validate(instance.parseText(data.c_str()), &reason);
+			bool streamed = compiled && schema.validateText(data.c_str(), &streamReason);
+			if (valid == (Bool)test["valid"] && streamed == valid)
+			{
+				passed++;
+				continue;
+			}
+			failed++;
+			std::cout << "FAIL " << path << ": " << group["description"] << " / " << test["description"];
+			if (streamed != valid)
+				std::cout << " (validate: " << (valid ? "valid" : reason) << ", validateText: "
+						  << (streamed ? "valid" : streamReason) << ")" << std::endl;
+			else
+				std::cout << " (expected " << (valid ? "invalid" : "valid") << ")"
+						  << (reason.empty() ? "" : ": ") << reason << std::endl;
+		}
+	}
+	return true;
+}
+
+int main()
+{
+	std::ifstream list("tests/list.txt");
+	if (!list)
+	{
+		std::cout << "cannot open tests/list.txt, run from the repository root" << std::endl;
+		return 1;
+	}
+	size_t passed = 0, failed = 0, suites = 0;
+	bool broken = false;
+	String entry;
+	while (std::getline(list, entry))
+	{
+		if (entry.empty())
+			continue;
+		if (entry.compare(0, 7, "draft7/") != 0)
+		{
+			std::cout << "skipped " << entry << ": not a draft-07 suite" << std::endl;
+			continue;
+		}
+		if (!runSuite("tests/" + entry, passed, failed))
+		{
+			std::cout << "cannot read tests/" << entry << std::endl;
+			broken = true;
+		}
+		suites++;
+	}
+	runAgreement(passed, failed);
+	std::cout << suites << " suites, " << passed << " cases passed, " << failed << " failed" << std::endl;
+	return failed || broken ? 1 : 0;
+}
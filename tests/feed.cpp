@@ -0,0 +1,85 @@
+/**
+ * @file feed.cpp
+ * @brief Documents given to JSON::feed in pieces: split at every position, in
+ * chunks of a few characters and whole, they build the tree Parse builds, and
+ * invalid documents stay invalid wherever they are split.
+ */
+
+#include "check.h"
+
+// A document with every kind of token, long enough to cross the chunks of a few sizes
+static const char* document =
+	"{\"name\":\"caf\xC3\xA9 \\\"du\\\" coin\",\"escapes\":\"\\\\\\/\\b\\f\\n\\r\\t\\u00e9\\uD83D\\uDE00\","
+	"\"numbers\":[0,-0,12345678901234567890,-9223372036854775808,3.14159,-2.5e-300,1E+10,0.1e1],"
+	"\"literals\":[true,false,null],\"empty\":{},\"nothing\":[],\"nested\":{\"a\":[{\"b\":[[],{}]}],\"c\":\"\"},"
+	"\"space\" :\t[ 1 ,\r\n 2 ] , \"last\":\"\\u0041\"}";
+
+/** feeds()
+ * @brief Gives a text to a handler in chunks
+ * @param handler Handler that builds the tree
+ * @param source Text of the document
+ * @param cuts Positions where a chunk ends, in increasing order
+ * @param flags Combination of ParseFlags
+ * @return Tree of finish(), or the empty tree once the document is invalid
+ */
+static json::let& feeds(json::JSON& handler, const String& source, const std::vector<size_t>& cuts, unsigned flags = json::parseDefault)
+{
+	size_t from = 0;
+	for (size_t cut : cuts)
+	{
+		if (!handler.feed(source.data() + from, cut - from, flags))
+			return handler.finish();
+		from = cut;
+	}
+	handler.feed(source.data() + from, source.size() - from, flags);
+	return handler.finish();
+}
+
+int main()
+{
+	json::JSON whole, pieces;
+	String source = document, expected = text(parse(whole, source));
+	CHECK(whole.isValid());
+
+	// Two chunks split at every position, then three
+	for (size_t cut = 0; cut <= source.size(); cut++)
+		if (!CHECK(text(feeds(pieces, source, { cut })) == expected && pieces.isValid()))
+			std::cout << "  split at " << cut << ": " << text(pieces.finish()) << std::endl;
+	for (size_t cut = 1; cut + 1 < source.size(); cut += 3)
+		CHECK(text(feeds(pieces, source, { cut, cut + 1 })) == expected);
+
+	// Chunks of 1 to 16 characters
+	for (size_t chunk = 1; chunk <= 16; chunk++)
+	{
+		std::vector<size_t> cuts;
+		for (size_t cut = chunk; cut < source.size(); cut += chunk)
+			cuts.push_back(cut);
+		CHECK(text(feeds(pieces, source, cuts)) == expected);
+		CHECK(text(feeds(pieces, source, cuts, json::parseNoIndex)) == expected);
+		CHECK(text(feeds(pieces, source, cuts, json::parseValidateUtf8)) == expected);
+	}
+
+	// Scalar roots and whitespace
+	static const char* scalars[] = { "12", " -0.5e3 ", "\"a\\u00e9b\"", "true", "null", " [ ] ", "\n{ }\n" };
+	for (const char* scalar : scalars)
+	{
+		String root = scalar, rootText = text(parse(whole, root));
+		for (size_t cut = 0; cut <= root.size(); cut++)
+			CHECK(text(feeds(pieces, root, { cut })) == rootText && pieces.isValid());
+	}
+
+	// Invalid documents, wherever they are split
+	static const char* invalid[] = {
+		"{\"a\":1,}", "[1,2", "{\"a\" 1}", "[\"abc]", "[\"\\x\"]", "[01]", "[1.]", "[tru]", "[nul]", "{\"a\":1}}", "[1]x",
+	};
+	for (const char* text : invalid)
+	{
+		String bad = text;
+		for (size_t cut = 0; cut <= bad.size(); cut++)
+			CHECK(feeds(pieces, bad, { cut }).getType() == json::Type::None && !pieces.isValid());
+	}
+
+	// The handler reads the next document after an invalid one
+	CHECK(text(feeds(pieces, source, { 10, 20 })) == expected && pieces.isValid());
+	return checkResult("feed");
+}
@@ -0,0 +1,128 @@
+/**
+ * @file index.cpp
+ * @brief Structural index of every classifier against a character by
+ * character walk, on strings with escaped quotes and backslash runs that
+ * cross the 64 characters blocks, and parses through the index against
+ * parses without it.
+ */
+
+#include "check.h"
+
+/** referenceIndex()
+ * @brief Lists the positions buildStructuralIndex() lists, one character at
+ * a time, for a valid JSON text
+ * @param text JSON text
+ * @return Positions of { } [ ] : , opening quotes and scalar starts, then the length
+ */
+static std::vector<unsigned> referenceIndex(const String& text)
+{
+	std::vector<unsigned> index;
+	bool inString = false, escaped = false, inScalar = false;
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		char c = text[i];
+		if (inString)
+		{
+			if (escaped)
+				escaped = false;
+			else if (c == '\\')
+				escaped = true;
+			else if (c == '"')
+				inString = false;
+			continue;
+		}
+		if (strchr("{}[]:,", c))
+			index.push_back((unsigned)i), inScalar = false;
+		else if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+			inScalar = false;
+		else if (c == '"')
+			index.push_back((unsigned)i), inString = true, inScalar = false;
+		else if (!inScalar)
+			index.push_back((unsigned)i), inScalar = true;
+	}
+	index.push_back((unsigned)text.size());
+	return index;
+}
+
+// Classifiers of this build and processor
+static std::vector<std::pair<const char*, json::BlockClassifier>> classifiers()
+{
+	std::vector<std::pair<const char*, json::BlockClassifier>> all;
+	all.emplace_back("scalar", json::classifyScalar);
+#ifdef JSON_SIMD_X86
+	all.emplace_back("SSE2", json::classifySSE2);
+	if (json::hasAVX2())
+		all.emplace_back("AVX2", json::classifyAVX2);
+#endif
+	return all;
+}
+
+/** indexes()
+ * @brief Indexes a text with every classifier and parses it with and without
+ * the index
+ * @param source Valid JSON text
+ * @return true if every index is the reference and the parses agree
+ */
+static bool indexes(const String& source)
+{
+	std::vector<unsigned> expected = referenceIndex(source), index;
+	bool same = true;
+	for (auto& classifier : classifiers())
+	{
+		index.clear();
+		bool indexed = json::buildStructuralIndex(source.c_str(), source.size(), index, nullptr, classifier.second);
+		if (!indexed || index != expected)
+		{
+			std::cout << "  " << classifier.first << " index differs on " << source << std::endl;
+			same = false;
+		}
+	}
+	json::JSON indexed, walked;
+	String withIndex = text(parse(indexed, source)), withoutIndex = text(parse(walked, source, json::parseNoIndex));
+	if (!indexed.isValid() || !walked.isValid() || withIndex != withoutIndex)
+	{
+		std::cout << "  parses differ on " << source << ": " << withIndex << " / " << withoutIndex << std::endl;
+		same = false;
+	}
+	return same;
+}
+
+int main()
+{
+	// String contents with escapes, each placed at every offset of two blocks
+	static const char* contents[] = {
+		"a\\\"b", "\\\\", "\\\\\\\"", "\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\"", "\\\"\\\"\\\"", "x\\\\\\\\\\\\\\\"y\\\\",
+		"{[:,]} \\\"{[,:]}\\\" ", "\\/\\b\\f\\n\\r\\t\\u0022\\u005C",
+		"quotes \\\" every \\\" few \\\" characters \\\" that \\\" go \\\" on \\\" and \\\" on \\\" past \\\" one \\\" block",
+	};
+	for (const char* content : contents)
+		for (int pad = 0; pad <= 140; pad++)
+		{
+			String source = "{\"k\":[" + String(pad, ' ') + "\"" + content + "\"," + String(pad % 7, '\n') +
+							"123,-4.5e6,true,\"" + content + "\",{\"" + content + "\":null},[]]}";
+			if (!CHECK(indexes(source)))
+				break;
+		}
+
+	// Scalars and operators at the end of a block and of the text
+	for (int pad = 0; pad <= 140; pad++)
+	{
+		CHECK(indexes("[" + String(pad, ' ') + "12345,false,null,\"\",\"\\\\\"]"));
+		CHECK(indexes(String(pad, '\t') + "{\"a\":[1,2,3]}"));
+		CHECK(indexes("[" + String(pad, '1') + "]"));
+		CHECK(indexes("[\"" + String(pad, '\\') + String(pad, '\\') + "\"]"));
+	}
+
+	// Comments and control characters outside of strings are left to the parser
+	std::vector<unsigned> index;
+	for (auto& classifier : classifiers())
+	{
+		String comment = "[1,/* two */2]", control = "[1,\x01 2]", quoted = "[\"/* not a comment */\"]";
+		CHECK(!json::buildStructuralIndex(comment.c_str(), comment.size(), index, nullptr, classifier.second));
+		CHECK(!json::buildStructuralIndex(control.c_str(), control.size(), index, nullptr, classifier.second));
+		index.clear();
+		CHECK(json::buildStructuralIndex(quoted.c_str(), quoted.size(), index, nullptr, classifier.second));
+		CHECK(index == referenceIndex(quoted));
+	}
+	return checkResult("index");
+}
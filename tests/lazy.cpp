@@ -0,0 +1,43 @@
+/**
+ * @file lazy.cpp
+ * @brief Values of lazy documents (parseLazy) taken out of the tree: copies
+ * and moves must not read the index of the handler after its next parse or
+ * after it is destroyed.
+ */
+
+#include "check.h"
+
+int main()
+{
+	const String source = "{\"store\":[[1,2],[3,[4,5]]],\"other\":{\"a\":[6]}}";
+
+	// A moved child outlives its handler
+	json::let moved;
+	{
+		json::JSON handler;
+		json::let& root = parse(handler, source, json::parseLazy);
+		moved = std::move(root["store"]);
+		CHECK(root["store"].getType() == json::Type::None);
+	}
+	CHECK(moved.size() == 2);
+	CHECK(text(moved) == "[[1,2],[3,[4,5]]]");
+
+	// Moved and copied children keep their values when the handler parses again
+	json::JSON handler;
+	json::let& root = parse(handler, source, json::parseLazy);
+	json::let copy = root["store"];
+	json::let taken(std::move(root["other"]["a"]));
+	parse(handler, "[[7,8,9],{\"b\":[10,11,12,13]}]", json::parseLazy);
+	CHECK(text(copy) == "[[1,2],[3,[4,5]]]");
+	CHECK(text(taken) == "[6]");
+
+	// Lazy arrays with many members, counted before they are added
+	String wide = "[";
+	for (int i = 0; i < 100; i++)
+		wide += i ? ",[" + std::to_string(i) + "]" : "[0]";
+	json::let& many = parse(handler, wide + "]", json::parseLazy);
+	CHECK(many.size() == 100);
+	CHECK(many[99][0].getType() != json::Type::None && text(many[99]) == "[99]");
+	CHECK(text(many) == wide + "]");
+	return checkResult("lazy");
+}
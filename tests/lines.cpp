@@ -0,0 +1,108 @@
+/**
+ * @file lines.cpp
+ * @brief JSON Lines through LineReader: CRLF and LF newlines, empty and blank
+ * lines, a last line without newline, invalid records and texts split among
+ * several threads, against every line parsed alone.
+ */
+
+#include "check.h"
+#include <mutex>
+
+/** expected()
+ * @brief Parses every non blank line of a text alone
+ * @param source JSON Lines text
+ * @param invalid Receives the positions of the records that are not valid
+ * @return Text of every record, empty for invalid ones
+ */
+static std::vector<String> expected(const String& source, std::vector<size_t>& invalid)
+{
+	std::vector<String> records;
+	json::JSON reader;
+	size_t start = 0;
+	while (start <= source.size())
+	{
+		size_t end = source.find('\n', start);
+		end = end == String::npos ? source.size() : end;
+		String line = source.substr(start, end - start);
+		start = end + 1;
+		if (line.find_first_not_of(" \t\r") == String::npos)
+			continue;
+		json::let& root = parse(reader, line);
+		if (!reader.isValid())
+			invalid.push_back(records.size());
+		records.push_back(reader.isValid() ? text(root) : String());
+	}
+	return records;
+}
+
+/** reads()
+ * @brief Reads a text with parse() and forEach() and compares the records
+ * with the lines parsed alone
+ * @param lines Reader to use
+ * @param source JSON Lines text, without raw newlines inside strings
+ * @return true if the records and the invalid ones are the same
+ */
+static bool reads(json::LineReader& lines, const String& source)
+{
+	std::vector<size_t> invalid;
+	std::vector<String> wanted = expected(source, invalid);
+	const std::vector<json::let>& records = lines.parse(source.data(), source.size());
+	bool same = records.size() == wanted.size() && lines.errors().size() == invalid.size();
+	for (size_t r = 0; same && r < records.size(); r++)
+		same = records[r].getType() == json::Type::None ? wanted[r].empty() : text(records[r]) == wanted[r];
+	for (size_t e = 0; same && e < invalid.size(); e++)
+		same = lines.errors()[e].first == invalid[e] && records[invalid[e]].getType() == json::Type::None;
+
+	std::vector<String> each(wanted.size());
+	std::mutex guard;
+	size_t count = lines.forEach(source.data(), source.size(), [&](size_t r, const json::let& value, const json::JSON& parser) {
+		std::lock_guard<std::mutex> lock(guard);
+		if (r < each.size())
+			each[r] = parser.isValid() ? text(value) : String();
+	});
+	same = same && count == wanted.size() && each == wanted;
+	if (!same)
+		std::cout << "  records differ on " << source.substr(0, 200) << std::endl;
+	return same;
+}
+
+int main()
+{
+	json::LineReader single(1), several(4);
+	static const char* texts[] = {
+		"{\"a\":1}\n{\"b\":[1,2]}\n",
+		"{\"a\":1}\r\n{\"b\":[1,2]}\r\n\"last\"",
+		"{\"a\":1}\n\n\n  \n\t\r\n[true]",
+		"\n\r\n1\n2\r\n3",
+		"{\"text\":\"with \\\"quotes\\\" and \\\\n\"}\r\n{\"k\":\"\\\\\"}\n",
+		"{\"a\":1}\n{\"broken\":}\n[2]\n{\"a\":\n[3]",
+		"",
+		"\n\n",
+		"  [1]  ",
+	};
+	for (const char* source : texts)
+	{
+		CHECK(reads(single, source));
+		CHECK(reads(several, source));
+	}
+
+	// A newline inside a string does not end the record
+	String raw = "{\"a\":\"one\ntwo\"}\n[1]";
+	CHECK(single.parse(raw.data(), raw.size()).size() == 2 && single.errors().empty());
+	CHECK(text(single.parse(raw.data(), raw.size())[0]) == "{\"a\":\"one\\ntwo\"}");
+
+	// Texts over 1 MB are split in ranges, strings with escaped quotes and newlines cross them
+	String big;
+	for (int r = 0; big.size() < (2 << 20); r++)
+	{
+		big += "{\"id\":" + std::to_string(r) + ",\"text\":\"" + String(r % 97, 'x') + "\\\"\\n\\\\\",\"list\":[" +
+			   std::to_string(r % 13) + "," + std::to_string(r * 0.5) + "]}";
+		big += r % 3 ? "\n" : r % 5 ? "\r\n" : "\n\n";
+		if (r % 1000 == 999)
+			big += "{\"invalid\":[1,}\n";
+	}
+	big += "{\"last\":true}";
+	CHECK(reads(several, big));
+	CHECK(reads(single, big));
+	return checkResult("lines");
+}
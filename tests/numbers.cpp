@@ -0,0 +1,95 @@
+/**
+ * @file numbers.cpp
+ * @brief Numbers read by the parser against strtod: the exact Clinger range,
+ * the Eisel-Lemire path at its boundaries, the strtod fallback for long
+ * significands and integers at the limits of int64.
+ */
+
+#include "check.h"
+#include <random>
+
+// Bits of a double, so -0.0 and 0.0 or two NaNs are told apart
+static unsigned long long bits(double value)
+{
+	unsigned long long out;
+	memcpy(&out, &value, sizeof(out));
+	return out;
+}
+
+/** parsesAs()
+ * @brief Parses a number inside an array and compares it with strtod
+ * @param handler Handler that parses the text
+ * @param number Text of the number
+ * @return true if the parsed double has the bits of strtod
+ */
+static bool parsesAs(json::JSON& handler, const String& number)
+{
+	json::let& root = parse(handler, "[" + number + "]");
+	if (!handler.isValid() || root.size() != 1 || root[0].index() != 4)
+	{
+		std::cout << "  " << number << " not read as a double: " << text(root) << std::endl;
+		return false;
+	}
+	double parsed = root[0];
+	if (bits(parsed) == bits(strtod(number.c_str(), nullptr)))
+		return true;
+	std::cout << "  " << number << " parsed as " << parsed << std::endl;
+	return false;
+}
+
+int main()
+{
+	json::JSON reader;
+	static const char* exact[] = {
+		// Clinger: significand below 2^53, power of ten up to 22
+		"1.0", "0.1", "0.3", "1e22", "1e-22", "9007199254740991e22", "9007199254740991e-22",
+		"123456789012345e-15", "4.35", "2.5e10", "-0.0", "0.0e5",
+		// Eisel-Lemire: just outside the exact range
+		"1e23", "1e-23", "9007199254740993e0", "9007199254740993.0", "9007199254740992e1",
+		"8.98846567431158e307", "1.7976931348623157e308", "2.2250738585072014e-308",
+		"2.2250738585072011e-308", "4.9406564584124654e-324", "5e-324", "2.4703282292062328e-324",
+		"7.2057594037927933e16", "1.00000000000000011102230246251565404236316680908203125",
+		"9223372036854775808", "-9223372036854775809", "18446744073709551615", "1e-400", "1e400",
+		"0.000000000000000000000000000000000000000000000000000000000000001",
+		// Fallback: more than 19 significant digits
+		"12345678901234567890", "1234567890123456789012345678901234567890e-20",
+		"9007199254740992.000000000000000000001", "2.22507385850720138309023271733240406421921598046233e-308",
+		"0.1000000000000000055511151231257827021181583404541015625",
+		"7.4109846876186981626485318930233205854758970392148714663837852375101326090531312779794975454245398856969484704316857659638998506553390969459816219401617281718945106978546710679176872575177347315553307795408549809608457500958111373034747658096871009590975442271004757307809711118935784838675653998783503015228055934046593739791790738723868299395818481660169122019456499931289798411362062484498678713572180352209017023903285791732520220528974020802906854021606612375549983402671300035812486479041385743401875520901590172592547146296175134159774938718574737870961645638908718119841271673056017045493004705269590165763776884908267986972573366521765567941072508764337505",
+	};
+	for (const char* number : exact)
+		CHECK(parsesAs(reader, number));
+
+	// Integers stay integers up to the limits of int64, beyond them they are doubles
+	json::let& limits = reader.parseText("[9223372036854775807,-9223372036854775808,9223372036854775808,1e2,-0]");
+	CHECK(reader.isValid());
+	CHECK(limits[0].index() == 2 && (long long)limits[0] == 9223372036854775807LL);
+	CHECK(limits[1].index() == 2 && (long long)limits[1] == -9223372036854775807LL - 1);
+	CHECK(limits[2].index() == 4 && (double)limits[2] == 9223372036854775808.0);
+	CHECK(limits[3].index() == 4 && (double)limits[3] == 100.0);
+	CHECK(limits[4].index() == 2 && (long long)limits[4] == 0);
+
+	// Not numbers
+	static const char* invalid[] = { "[01]", "[1.]", "[.5]", "[1e]", "[1e+]", "[-]", "[+1]", "[0x10]" };
+	for (const char* text : invalid)
+		CHECK((reader.parseText(text), !reader.isValid()));
+
+	// Random doubles written with 1 to 17 digits, and long integers with a fraction
+	std::mt19937_64 random(20260417);
+	char number[64];
+	for (int i = 0; i < 100000; i++)
+	{
+		unsigned long long pattern = random();
+		double value;
+		memcpy(&value, &pattern, sizeof(value));
+		if (value != value || value - value != 0) // NaN and infinities are not JSON
+			continue;
+		snprintf(number, sizeof(number), "%.*e", (int)(pattern % 17), value);
+		if (!CHECK(parsesAs(reader, number)))
+			break;
+		snprintf(number, sizeof(number), "%llu", pattern >> (pattern % 64));
+		if (!CHECK(parsesAs(reader, String(number) + ".5")))
+			break;
+	}
+	return checkResult("numbers");
+}
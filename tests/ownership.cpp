@@ -0,0 +1,86 @@
+/**
+ * @file ownership.cpp
+ * @brief Keys and strings of values built by user code or copied: they must
+ * live as long as the value that holds them, not as long as the text, obj or
+ * handler they come from.
+ */
+
+#include "check.h"
+#include <thread>
+
+int main()
+{
+	// Keys inserted by user code are copied into their object
+	json::let built;
+	{
+		String name = "temporary key";
+		built[name] = 1;
+		built[name.c_str()] = 2;
+	}
+	CHECK(built.size() == 1);
+	CHECK(text(built) == "{\"temporary key\":2}");
+	json::obj members;
+	{
+		String other = "another";
+		members.emplace(other.c_str(), 3);
+		members.emplace(other.c_str(), 4);
+	}
+	json::let moved = std::move(members);
+	CHECK(text(moved) == "{\"another\":4}");
+
+	// Copies of an object own their keys
+	json::let copy;
+	{
+		json::let original;
+		for (int i = 0; i < 40; i++)
+			original["key " + std::to_string(i)] = i; // Past the size of the hash index of Map
+		copy = original;
+	}
+	CHECK(copy.size() == 40);
+	CHECK((long long)copy["key 39"] == 39 && (long long)copy["key 0"] == 0);
+	CHECK(copy.size() == 40);
+
+	// Copies of a parsed tree outlive the handler and its buffers
+	const String source = "{\"name\":\"caf\\u00e9\",\"list\":[\"a\",{\"deep\":\"b\"}],\"n\":1.5}";
+	json::let parsed, situ, reused;
+	{
+		json::JSON handler;
+		parsed = parse(handler, source);
+		json::JSON reader;
+		reused = reader.parseText(source.c_str());
+		reader.parseText("{\"name\":\"other\",\"list\":[]}");
+		json::JSON inSitu;
+		std::unique_ptr<char[]> buffer(new char[source.size() + 1]);
+		memcpy(buffer.get(), source.c_str(), source.size() + 1);
+		situ = inSitu.Parse(buffer.get(), json::parseInSitu);
+	}
+	const String expected = "{\"name\":\"caf\u00e9\",\"list\":[\"a\",{\"deep\":\"b\"}],\"n\":1.5}";
+	CHECK(text(parsed) == expected);
+	CHECK(text(reused) == expected);
+	CHECK(text(situ) == expected);
+	CHECK(text(situ["list"][1]["deep"]) == "\"b\"");
+
+	// Copies of borrowed strings own their characters
+	json::let copied;
+	{
+		std::unique_ptr<char[]> characters(new char[9]);
+		memcpy(characters.get(), "borrowed", 9);
+		json::let borrowed = (const char*)characters.get(); // Strings from pointers are not copied
+		copied = borrowed;
+	}
+	CHECK(text(copied) == "\"borrowed\"" && copied.size() == 8);
+
+	// Objects built by several threads share no key storage
+	std::vector<std::thread> threads;
+	std::vector<json::let> results(4);
+	for (size_t t = 0; t < results.size(); t++)
+		threads.emplace_back([t, &results] {
+			for (int i = 0; i < 1000; i++)
+				results[t]["id " + std::to_string(i * 4 + t)] = i;
+		});
+	for (auto& thread : threads)
+		thread.join();
+	for (size_t t = 0; t < results.size(); t++)
+		CHECK(results[t].size() == 1000 && (long long)results[t]["id " + std::to_string(999 * 4 + t)] == 999);
+	return checkResult("ownership");
+}
@@ -0,0 +1,77 @@
+/**
+ * @file parallel.cpp
+ * @brief Texts over 1 MB parsed with parseParallel by several threads: array
+ * and object roots, a large member deeper in the tree, keys repeated across
+ * the slices and errors inside a slice give what one thread gives.
+ */
+
+#include "check.h"
+
+// Member i of a large container: a small object with every kind of value
+static String member(size_t i)
+{
+	return "{\"id\":" + std::to_string(i) + ",\"name\":\"item " + std::to_string(i) + " \\u00e9\\\"\",\"ratio\":" +
+		   std::to_string(i * 0.25) + ",\"flags\":[true,false,null],\"tags\":{\"even\":" + (i % 2 ? "false" : "true") + "}}";
+}
+
+/** agrees()
+ * @brief Parses a text with one thread and with parseParallel
+ * @param source JSON text
+ * @param flags Flags added to both parses
+ * @return true if both give the same tree, or both reject the text
+ */
+static bool agrees(json::JSON& parallel, const String& source, unsigned flags = json::parseDefault)
+{
+	json::JSON single;
+	String expected = text(parse(single, source, flags)), split = text(parse(parallel, source, flags | json::parseParallel));
+	if (single.isValid() == parallel.isValid() && expected == split)
+		return true;
+	std::cout << "  parallel parse differs (" << (parallel.isValid() ? "valid" : parallel.getError()) << ")" << std::endl;
+	return false;
+}
+
+int main()
+{
+	json::JSON parallel;
+	parallel.setThreads(4);
+
+	// Array root
+	String array = "[";
+	for (size_t i = 0; array.size() < (1 << 20) + (1 << 16); i++)
+		array += (i ? "," : "") + member(i);
+	array += "]";
+	CHECK(agrees(parallel, array));
+
+	// Object root, with keys repeated in other slices: the first value is kept
+	String object = "{";
+	size_t members = 0;
+	for (; object.size() < (1 << 20) + (1 << 16); members++)
+		object += (members ? ",\"k" : "\"k") + std::to_string(members) + "\":" + member(members);
+	for (size_t i = 0; i < members; i += members / 7)
+		object += ",\"k" + std::to_string(i) + "\":\"repeated\"";
+	object += "}";
+	CHECK(agrees(parallel, object));
+	json::let& root = parse(parallel, object, json::parseParallel);
+	CHECK(root.size() == members && (long long)root["k0"]["id"] == 0);
+	CHECK((long long)root["k" + std::to_string(members / 7 * 3)]["id"] == (long long)(members / 7 * 3));
+
+	// The large array is a member of the root
+	String nested = "{\"type\":\"FeatureCollection\",\"features\":" + array + ",\"count\":1}";
+	CHECK(agrees(parallel, nested));
+	CHECK(agrees(parallel, nested, json::parseValidateUtf8));
+	CHECK(agrees(parallel, nested, json::parseInSitu));
+
+	// Errors inside a slice, or between slices
+	String broken = array;
+	broken[broken.size() / 2 + broken.substr(broken.size() / 2).find(",\"name\"")] = ' ';
+	CHECK(agrees(parallel, broken));
+	CHECK(!parallel.isValid() && parse(parallel, broken, json::parseParallel).getType() == json::Type::None);
+	CHECK(agrees(parallel, array.substr(0, array.size() - 1)));
+	CHECK(agrees(parallel, object.substr(0, object.size() / 2) + "}"));
+
+	// The handler and its helpers read the next document
+	CHECK(agrees(parallel, array));
+	parallel.setThreads(3);
+	CHECK(agrees(parallel, object));
+	return checkResult("parallel");
+}
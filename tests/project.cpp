@@ -0,0 +1,98 @@
+/**
+ * @file project.cpp
+ * @brief Documents parsed after JSON::project: only the projected values and
+ * the containers on the way to them are built, whatever the other members
+ * hold, and paths that may select several values are refused.
+ */
+
+#include "check.h"
+
+static const char* document =
+	"{\"type\":\"FeatureCollection\",\"skip\":{\"deep\":[1,{\"x\":\"\\\"}]\"}],\"n\":-1.5e3},"
+	"\"features\":[{\"type\":\"Feature\",\"id\":0,\"geometry\":{\"type\":\"Point\",\"coordinates\":[1.5,2.5]},"
+	"\"properties\":{\"name\":\"caf\\u00e9\",\"tags\":[\"a\",\"b\"]}},"
+	"{\"type\":\"Feature\",\"id\":1,\"geometry\":{\"type\":\"LineString\",\"coordinates\":[[0,0],[1,1]]},"
+	"\"properties\":{\"name\":\"two\",\"tags\":[]}},"
+	"{\"type\":\"Feature\",\"id\":2,\"geometry\":null,\"properties\":{}}],"
+	"\"a/b\":{\"m~n\":true},\"count\":3}";
+
+/** projects()
+ * @brief Parses the document with a projection
+ * @param handler Handler to project with
+ * @param paths Paths to keep
+ * @param flags Combination of ParseFlags
+ * @return Text of the tree, "refused" if project() refuses the paths
+ */
+static String projects(json::JSON& handler, const std::vector<String>& paths, unsigned flags = json::parseDefault)
+{
+	if (!handler.project(paths))
+		return "refused";
+	json::let& root = parse(handler, document, flags);
+	return handler.isValid() ? text(root) : "invalid: " + handler.getError();
+}
+
+int main()
+{
+	json::JSON whole, projected;
+	String all = text(parse(whole, document));
+	CHECK(whole.isValid());
+
+	static const struct
+	{
+		std::vector<String> paths;
+		const char* expected;
+	} table[] = {
+		{ { "/type" }, "{\"type\":\"FeatureCollection\"}" },
+		{ { "$.count", "$.type" }, "{\"type\":\"FeatureCollection\",\"count\":3}" },
+		{ { "/features/0/geometry/type" }, "{\"features\":[{\"geometry\":{\"type\":\"Point\"}}]}" },
+		{ { "$.features[1].geometry.coordinates[1]" }, "{\"features\":[null,{\"geometry\":{\"coordinates\":[null,[1,1]]}}]}" },
+		{ { "/features/2/properties", "/features/0/id" }, "{\"features\":[{\"id\":0},null,{\"properties\":{}}]}" },
+		{ { "/features/0/properties/name", "/features/0/properties/tags/1", "/features/1/id" },
+		  "{\"features\":[{\"properties\":{\"name\":\"caf\xC3\xA9\",\"tags\":[null,\"b\"]}},{\"id\":1}]}" },
+		{ { "/features/2/geometry" }, "{\"features\":[null,null,{\"geometry\":null}]}" },
+		{ { "/skip/deep" }, "{\"skip\":{\"deep\":[1,{\"x\":\"\\\"}]\"}]}}" },
+		{ { "/a~1b/m~0n" }, "{\"a/b\":{\"m~n\":true}}" },
+		{ { "$['a/b']" }, "{\"a/b\":{\"m~n\":true}}" },
+		{ { "/features", "/features/0/id" }, nullptr },
+		// Containers on the way are built even if the value is missing
+		{ { "/missing", "/features/9/id", "/type/deeper" }, "{\"features\":[null,null,null]}" },
+		// The root, as no projection, keeps the whole document
+		{ { "" }, nullptr },
+		{ { "$" }, nullptr },
+		{ {}, nullptr },
+		// Paths that may select several values, or positions from the end
+		{ { "$.features[*].id" }, "refused" },
+		{ { "$..id" }, "refused" },
+		{ { "$.features[0:2]" }, "refused" },
+		{ { "$.features[-1]" }, "refused" },
+		{ { "$.features[?(@.id)]" }, "refused" },
+		{ { "$[" }, "refused" },
+	};
+	for (auto& test : table)
+	{
+		// Without expected text: the whole document, or its features
+		String expected = test.expected ? test.expected : all;
+		if (!test.expected && test.paths.size() == 2)
+			expected = "{\"features\":" + text(whole.parseText(document)["features"]) + "}";
+		String result = projects(projected, test.paths);
+		if (!CHECK(result == expected))
+			std::cout << "  " << (test.paths.empty() ? "(none)" : test.paths[0]) << " projects " << result << std::endl;
+	}
+
+	// A refused projection keeps the previous one
+	CHECK(projected.project({ "/count" }) && !projected.project({ "$..id" }));
+	CHECK(text(parse(projected, document)) == "{\"count\":3}");
+
+	// Projections apply to the other ways of parsing, and are never lazy nor split
+	CHECK(text(projected.parseText(document)) == "{\"count\":3}");
+	CHECK(projects(projected, { "/features/1/id" }, json::parseLazy) == "{\"features\":[null,{\"id\":1}]}");
+	CHECK(projects(projected, { "/features/1/id" }, json::parseNoIndex) == "{\"features\":[null,{\"id\":1}]}");
+	CHECK(projects(projected, { "/features/1/id" }, json::parseParallel) == "{\"features\":[null,{\"id\":1}]}");
+
+	// Errors of the projected values are found, the ones of skipped values are not
+	CHECK(projected.project({ "/a" }));
+	CHECK((projected.parseText("{\"a\":[1,2,}"), !projected.isValid()));
+	CHECK((projected.parseText("{\"b\":[1,2,],\"a\":1}"), projected.isValid()));
+	CHECK((projected.parseText("{\"b\":1,\"a\":1"), !projected.isValid()));
+	return checkResult("project");
+}
@@ -0,0 +1,140 @@
+/**
+ * @file query.cpp
+ * @brief Query results on a document: JSON Pointer tokens and escapes,
+ * JSONPath names, positions, slices, unions, descendants and filters, the
+ * same on a lazy tree, JSON::find, and paths that do not compile.
+ */
+
+#include "check.h"
+
+static const char* store =
+	"{\"store\":{\"book\":["
+	"{\"category\":\"reference\",\"author\":\"Nigel Rees\",\"title\":\"Sayings of the Century\",\"price\":8.95},"
+	"{\"category\":\"fiction\",\"author\":\"Evelyn Waugh\",\"title\":\"Sword of Honour\",\"price\":12.99},"
+	"{\"category\":\"fiction\",\"author\":\"Herman Melville\",\"title\":\"Moby Dick\",\"isbn\":\"0-553-21311-3\",\"price\":8.99},"
+	"{\"category\":\"fiction\",\"author\":\"J. R. R. Tolkien\",\"title\":\"The Lord of the Rings\",\"isbn\":\"0-395-19395-8\",\"price\":22.99}],"
+	"\"bicycle\":{\"color\":\"red\",\"price\":19.95}},"
+	"\"expensive\":10,\"a/b\":1,\"m~n\":2,\"\":3,\"list\":[0,1,2,3,4,5,6,7,8,9],\"n\":{\"n\":{\"n\":null}}}";
+
+/** selects()
+ * @brief Evaluates a query
+ * @param path JSON Pointer or JSONPath query
+ * @param root Tree to evaluate it on
+ * @return Texts of the values found as a JSON array, "invalid" if the path
+ * does not compile
+ */
+static String selects(const String& path, const json::let& root)
+{
+	json::Query query(path);
+	if (!query.isValid())
+		return "invalid";
+	std::vector<const json::let*> found;
+	size_t count = query.evaluate(root, found);
+	String out = "[";
+	for (const json::let* value : found)
+		out += (out.size() > 1 ? "," : "") + text(*value);
+	out += "]";
+	// first() is the first value evaluate() finds
+	const json::let* first = query.first(root);
+	if (count != found.size() || (first ? !count || text(*first) != text(*found[0]) : count != 0))
+		return "first() differs from evaluate()";
+	return out;
+}
+
+/** checkAll()
+ * @brief Checks every query of the table on a tree
+ * @param root Tree parsed from store
+ * @return Number of queries with other results
+ */
+static int checkAll(const json::let& root)
+{
+	static const char* table[][2] = {
+		// JSON Pointer
+		{ "", nullptr },
+		{ "/store/bicycle/color", "[\"red\"]" },
+		{ "/store/book/1/price", "[12.99]" },
+		{ "/store/book/4", "[]" },
+		{ "/store/book/01", "[]" },
+		{ "/store/book/-", "[]" },
+		{ "/a~1b", "[1]" },
+		{ "/m~0n", "[2]" },
+		{ "/", "[3]" },
+		{ "/list/9", "[9]" },
+		{ "/missing/key", "[]" },
+		{ "/n/n/n", "[null]" },
+		// JSONPath names and positions
+		{ "$", nullptr },
+		{ "$.store.book[0].title", "[\"Sayings of the Century\"]" },
+		{ "$['store']['bicycle']['color']", "[\"red\"]" },
+		{ "$[\"a/b\"]", "[1]" },
+		{ "$.store.book[-1].author", "[\"J. R. R. Tolkien\"]" },
+		{ "$.store.book[-5]", "[]" },
+		{ "$.store.book[*].author", "[\"Nigel Rees\",\"Evelyn Waugh\",\"Herman Melville\",\"J. R. R. Tolkien\"]" },
+		{ "$.store.*.color", "[\"red\"]" },
+		{ "$..author", "[\"Nigel Rees\",\"Evelyn Waugh\",\"Herman Melville\",\"J. R. R. Tolkien\"]" },
+		{ "$.store..price", "[8.95,12.99,8.99,22.99,19.95]" },
+		{ "$..n", "[{\"n\":{\"n\":null}},{\"n\":null},null]" },
+		{ "$..book[2].isbn", "[\"0-553-21311-3\"]" },
+		// Slices and unions
+		{ "$.list[1:4]", "[1,2,3]" },
+		{ "$.list[:3]", "[0,1,2]" },
+		{ "$.list[7:]", "[7,8,9]" },
+		{ "$.list[-2:]", "[8,9]" },
+		{ "$.list[::3]", "[0,3,6,9]" },
+		{ "$.list[8:2:-2]", "[8,6,4]" },
+		{ "$.list[::-4]", "[9,5,1]" },
+		{ "$.list[5:5]", "[]" },
+		{ "$.list[1:2:0]", "[]" },
+		{ "$.list[0,9,-1]", "[0,9,9]" },
+		{ "$['expensive','a/b']", "[10,1]" },
+		{ "$.store.book[0,2].title", "[\"Sayings of the Century\",\"Moby Dick\"]" },
+		// Filters
+		{ "$.store.book[?(@.price < 10)].title", "[\"Sayings of the Century\",\"Moby Dick\"]" },
+		{ "$.store.book[?(@.isbn)].title", "[\"Moby Dick\",\"The Lord of the Rings\"]" },
+		{ "$.store.book[?(!@.isbn)].price", "[8.95,12.99]" },
+		{ "$.store.book[?(@.price > $.expensive)].price", "[12.99,22.99]" },
+		{ "$.store.book[?(@.category == 'fiction' && @.price <= 12.99)].price", "[12.99,8.99]" },
+		{ "$.store.book[?(@.category != \"fiction\" || @.price >= 20)].author", "[\"Nigel Rees\",\"J. R. R. Tolkien\"]" },
+		{ "$.store.book[?(!(@.price < 9 || @.price > 20))].price", "[12.99]" },
+		{ "$.list[?(@ >= 8)]", "[8,9]" },
+		{ "$..[?(@.color == 'red')].price", "[19.95]" },
+		{ "$.n[?(@.n == null)]", "[{\"n\":null}]" },
+		// Not valid
+		{ "store", "invalid" },
+		{ "/m~2n", "invalid" },
+		{ "$.store[", "invalid" },
+		{ "$.store.book[?(@.price <)]", "invalid" },
+		{ "$['unterminated]", "invalid" },
+	};
+	int failed = 0;
+	for (auto& test : table)
+	{
+		String result = selects(test[0], root), expected = test[1] ? test[1] : "[" + text(root) + "]";
+		if (!CHECK(result == expected))
+			std::cout << "  " << test[0] << " selects " << result << std::endl, failed++;
+	}
+	return failed;
+}
+
+int main()
+{
+	json::JSON reader, lazy;
+	json::let& root = parse(reader, store);
+	CHECK(reader.isValid() && checkAll(root) == 0);
+	json::let& lazyRoot = parse(lazy, store, json::parseLazy);
+	CHECK(lazy.isValid() && checkAll(lazyRoot) == 0);
+
+	// JSON::find() gives the first value of the tree of the handler
+	const json::let* title = reader.find("$.store.book[?(@.price > 20)].title");
+	CHECK(title && text(*title) == "\"The Lord of the Rings\"");
+	CHECK(reader.find("/store/book/3/title") == title);
+	CHECK(reader.find("$.nothing") == nullptr && reader.find("$[") == nullptr);
+
+	// A query is compiled once and evaluated on any tree
+	json::Query query("$..price");
+	std::vector<const json::let*> found;
+	CHECK(query.evaluate(root, found) == 5 && query.evaluate(reader.parseText("[{\"price\":1}]"), found) == 1);
+	CHECK(found.size() == 6 && text(*found[5]) == "1");
+	CHECK(query.compile("$.x[") == false && !query.isValid() && !query.getError().empty());
+	return checkResult("query");
+}
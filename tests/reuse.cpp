@@ -0,0 +1,42 @@
+/**
+ * @file reuse.cpp
+ * @brief One handler parsing many documents through JSON::parseText: the
+ * fields of each tree are read in place, and the objects and arrays recycled
+ * from the previous tree hold nothing of it.
+ */
+
+#include "check.h"
+
+int main()
+{
+	json::JSON reader;
+	for (int round = 0; round < 3; round++)
+	{
+		json::let& first = reader.parseText("{\"id\":7,\"name\":\"first\",\"tags\":[\"a\",\"b\",\"c\"],\"nested\":{\"x\":1}}");
+		CHECK(reader.isValid());
+		CHECK((long long)first["id"] == 7);
+		CHECK(text(first["name"]) == "\"first\"");
+		CHECK(first["tags"].size() == 3 && text(first["tags"][2]) == "\"c\"");
+		CHECK((long long)first["nested"]["x"] == 1);
+
+		// The containers of the first tree are reused, in the order they open
+		json::let& second = reader.parseText("{\"nested\":{\"y\":2.5},\"tags\":[],\"list\":[{\"id\":1},{\"id\":2}]}");
+		CHECK(reader.isValid());
+		CHECK(second.size() == 3);
+		CHECK(second["nested"].size() == 1 && (double)second["nested"]["y"] == 2.5);
+		CHECK(second["tags"].size() == 0);
+		CHECK((long long)second["list"][1]["id"] == 2);
+		CHECK(text(second) == "{\"nested\":{\"y\":2.5},\"tags\":[],\"list\":[{\"id\":1},{\"id\":2}]}");
+
+		// The tree is changed in place
+		second["added"] = "value";
+		CHECK(text(second["added"]) == "\"value\"");
+
+		// An invalid text leaves an empty tree, the next one parses again
+		json::let& broken = reader.parseText("{\"id\":[1,2}");
+		CHECK(!reader.isValid() && broken.getType() == json::Type::None);
+		json::let& array = reader.parseText("[1,[2,[3]]]");
+		CHECK(reader.isValid() && (long long)array[1][1][0] == 3);
+	}
+	return checkResult("reuse");
+}
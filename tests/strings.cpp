@@ -0,0 +1,84 @@
+/**
+ * @file strings.cpp
+ * @brief Strings and keys read by the parser, copied and in situ: every
+ * escape decoded to UTF-8, NUL characters kept with the length, long runs
+ * across the widths of the scanner, and invalid escapes rejected.
+ */
+
+#include "check.h"
+
+/** decodes()
+ * @brief Parses a string with and without parseInSitu
+ * @param source JSON text of the string
+ * @param expected Characters of the decoded string
+ * @return true if both parses give the expected characters
+ */
+static bool decodes(const String& source, const String& expected)
+{
+	json::JSON copied, inSitu;
+	json::let& first = parse(copied, "[" + source + "]");
+	std::vector<char> buffer(source.begin(), source.end());
+	buffer.insert(buffer.begin(), '['), buffer.push_back(']'), buffer.push_back('\0');
+	json::let& second = inSitu.Parse(buffer.data(), json::parseInSitu);
+	bool same = true;
+	for (json::let* root : { &first, &second })
+	{
+		if (!copied.isValid() || !inSitu.isValid() || root->size() != 1 || (*root)[0].getType() != json::Type::String)
+		{
+			std::cout << "  " << source << " is not read as a string" << std::endl;
+			return false;
+		}
+		String value = (*root)[0];
+		if (value != expected || (*root)[0].size() != expected.size())
+			std::cout << "  " << source << " read as " << text(*root) << std::endl, same = false;
+	}
+	return same;
+}
+
+int main()
+{
+	// Escapes
+	CHECK(decodes("\"\"", ""));
+	CHECK(decodes("\"plain\"", "plain"));
+	CHECK(decodes("\"\\\"\\\\\\/\\b\\f\\n\\r\\t\"", "\"\\/\b\f\n\r\t"));
+	CHECK(decodes("\"\\u0041\\u00e9\\u00E9\\u20AC\"", "A\xC3\xA9\xC3\xA9\xE2\x82\xAC"));
+	CHECK(decodes("\"\\uD83D\\uDE00 \\uDBFF\\uDFFF\"", "\xF0\x9F\x98\x80 \xF4\x8F\xBF\xBF"));
+	CHECK(decodes("\"Arri\xC3\xA8re-sc\xC3\xA8ne\"", "Arri\xC3\xA8re-sc\xC3\xA8ne"));
+
+	// NUL characters are kept, the length tells where the string ends
+	CHECK(decodes("\"a\\u0000b\"", String("a\0b", 3)));
+	CHECK(decodes("\"\\u0000\"", String(1, '\0')));
+
+	// Escapes at every position of runs longer than the scanner width
+	for (int run = 0; run < 70; run++)
+	{
+		String plain(run, 'x');
+		CHECK(decodes("\"" + plain + "\\n" + plain + "\"", plain + "\n" + plain));
+		CHECK(decodes("\"" + plain + "\\u00e9" + plain + "\\\"\"", plain + "\xC3\xA9" + plain + "\""));
+		CHECK(decodes("\"" + plain + "\"", plain));
+	}
+
+	// Invalid escapes and unterminated strings
+	static const char* invalid[] = {
+		"[\"\\x\"]", "[\"\\u12\"]", "[\"\\u12G4\"]", "[\"\\uD800\"]", "[\"\\uD800\\u0041\"]", "[\"\\uDC00\"]",
+		"[\"abc", "[\"abc\\\"]", "[\"\\", "{\"key", "{\"a\\q\":1}",
+	};
+	json::JSON reader;
+	for (const char* source : invalid)
+		CHECK((reader.parseText(source), !reader.isValid()));
+
+	// Keys with escapes and NUL characters are different keys
+	json::let& keys = reader.parseText("{\"a\\u0000b\":1,\"a\":2,\"a\\u0000\":3,\"\\u00e9\":4,\"\\n\":5}");
+	CHECK(reader.isValid() && keys.size() == 5);
+	CHECK((long long)keys["a"] == 2);
+	CHECK((long long)keys["\xC3\xA9"] == 4 && (long long)keys["\n"] == 5);
+	CHECK(text(keys) == "{\"a\\u0000b\":1,\"a\":2,\"a\\u0000\":3,\"\xC3\xA9\":4,\"\\n\":5}");
+
+	// Written strings read back to the same characters
+	String written = text(reader.parseText("[\"a\\u0000b\\u001f\\\"\\\\\\/\\b\\f\\n\\r\\t\\uD83D\\uDE00\"]"));
+	CHECK(reader.isValid());
+	json::JSON again;
+	CHECK(text(parse(again, written)) == written);
+	CHECK(again.isValid() && parse(again, written)[0].size() == 16);
+	return checkResult("strings");
+}
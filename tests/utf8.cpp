@@ -0,0 +1,122 @@
+/**
+ * @file utf8.cpp
+ * @brief UTF-8 validation: validateUtf8 against the byte by byte decoder, and
+ * parseValidateUtf8 rejecting invalid sequences at the edges of the blocks
+ * and chunks of the structural index, with the byte offset in the error.
+ */
+
+#include "check.h"
+#include <random>
+
+// Invalid sequences, each reported at its first byte
+static const char* invalid[] = {
+	"\x80",				// Continuation without a lead
+	"\xBF\x80",			// Continuations without a lead
+	"\xC0\xAF",			// Overlong '/'
+	"\xC1\xBF",			// Overlong 2 bytes
+	"\xE0\x80\xAF",		// Overlong 3 bytes
+	"\xF0\x80\x80\xAF", // Overlong 4 bytes
+	"\xED\xA0\x80",		// High surrogate
+	"\xED\xBF\xBF",		// Low surrogate
+	"\xF4\x90\x80\x80", // Above U+10FFFF
+	"\xF5\x80\x80\x80", // Lead above F4
+	"\xFE",
+	"\xFF",
+	"\xC3",				// Truncated by the closing quote
+	"\xE2\x82",
+	"\xF0\x9F\x98",
+	"\xC3\xC3\xA9",		// Lead followed by a lead
+};
+
+// Valid sequences of every length, at the limits of their ranges
+static const char* valid[] = {
+	"\x7F", "\xC2\x80", "\xDF\xBF", "\xE0\xA0\x80", "\xED\x9F\xBF", "\xEE\x80\x80", "\xEF\xBF\xBF",
+	"\xF0\x90\x80\x80", "\xF4\x8F\xBF\xBF", "Arri\xC3\xA8re-sc\xC3\xA8ne \xE2\x82\xAC \xF0\x9F\x98\x80",
+};
+
+// validateUtf8 and the byte by byte decoder agree on a text
+static bool agrees(const String& text)
+{
+	const unsigned char* p = (const unsigned char*)text.data();
+	bool truncated = false, scalarTruncated = false;
+	size_t fast = json::validateUtf8(text.data(), text.size(), &truncated);
+	size_t scalar = json::validUtf8Scalar(p, 0, text.size(), &scalarTruncated);
+	return fast == scalar && truncated == scalarTruncated && json::validateUtf8(text.data(), text.size()) == scalar;
+}
+
+/** rejects()
+ * @brief Parses a text with parseValidateUtf8 through Parse, with and without
+ * the structural index, and through feed()
+ * @param source JSON text
+ * @param offset Expected byte offset of the invalid sequence
+ * @return true if every parse rejects the text at the offset
+ */
+static bool rejects(const String& source, size_t offset)
+{
+	String expected = "invalid UTF-8 sequence at byte offset " + std::to_string(offset) + " ";
+	bool all = true;
+	for (unsigned flags : { (unsigned)json::parseValidateUtf8, json::parseValidateUtf8 | json::parseNoIndex })
+	{
+		json::JSON reader;
+		parse(reader, source, flags);
+		if (reader.isValid() || reader.getError().find(expected) == String::npos)
+			std::cout << "  offset " << offset << ": " << reader.getError() << std::endl, all = false;
+	}
+	json::JSON streamed;
+	for (size_t i = 0; i < source.size(); i += 4096)
+		streamed.feed(source.data() + i, std::min<size_t>(4096, source.size() - i), json::parseValidateUtf8);
+	streamed.finish();
+	if (streamed.isValid() || streamed.getError().find(expected) == String::npos)
+		std::cout << "  offset " << offset << " fed: " << streamed.getError() << std::endl, all = false;
+	return all;
+}
+
+int main()
+{
+	// Sequences at every offset of a few validation blocks
+	for (size_t pad = 0; pad < 100; pad++)
+	{
+		for (const char* sequence : invalid)
+			CHECK(agrees(String(pad, 'a') + sequence + String(40, 'b')));
+		for (const char* sequence : valid)
+			CHECK(agrees(String(pad, 'a') + sequence + String(pad % 5, 'b')));
+	}
+
+	// Random texts, mostly of valid sequences
+	std::mt19937 random(20260417);
+	static const unsigned char bytes[] = { 'a', ' ', 0x80, 0x9F, 0xA0, 0xBF, 0xC2, 0xDF, 0xE0, 0xED, 0xEF, 0xF0, 0xF4, 0xF5 };
+	for (int i = 0; i < 20000; i++)
+	{
+		String text;
+		size_t length = random() % 200;
+		while (text.size() < length)
+			if (random() % 4)
+				text += valid[random() % (sizeof(valid) / sizeof(valid[0]))];
+			else
+				text += (char)bytes[random() % sizeof(bytes)];
+		if (!CHECK(agrees(text)))
+			break;
+	}
+
+	// Strict parses reject the sequences where the index works in blocks and chunks
+	static const size_t places[] = { 2, 30, 31, 32, 63, 64, 65, 127, 128, 16383, 16384, 16385, 16387, 32768 };
+	for (size_t place : places)
+		for (const char* sequence : invalid)
+		{
+			String source = "[\"" + String(place - 2, 'x') + sequence + "\",\"after\"]";
+			if (!CHECK(rejects(source, place)))
+				break;
+		}
+
+	// Valid texts are accepted, invalid ones too without the flag
+	json::JSON reader;
+	for (const char* sequence : valid)
+	{
+		String source = "{\"" + String(sequence) + "\":\"" + String(70, ' ') + sequence + "\"}";
+		parse(reader, source, json::parseValidateUtf8);
+		CHECK(reader.isValid());
+	}
+	parse(reader, "[\"\xFF\"]");
+	CHECK(reader.isValid());
+	return checkResult("utf8");
+}
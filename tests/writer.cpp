@@ -0,0 +1,118 @@
+/**
+ * @file writer.cpp
+ * @brief Numbers written by json::dump: they read back to the same bits with
+ * strtod, with the fewest digits that do, in the layout of the writer.
+ */
+
+#include "check.h"
+#include <random>
+
+// Bits of a double, so -0.0 and 0.0 are told apart
+static unsigned long long bits(double value)
+{
+	unsigned long long out;
+	memcpy(&out, &value, sizeof(out));
+	return out;
+}
+
+// Significant digits of a number text, without sign, leading zeros, dot nor exponent
+static int digitCount(const String& number)
+{
+	size_t end = number.find_first_of("eE");
+	String digits;
+	for (size_t i = 0; i < number.size() && i < end; i++)
+		if (number[i] >= '0' && number[i] <= '9' && (!digits.empty() || number[i] != '0'))
+			digits += number[i];
+	while (!digits.empty() && digits.back() == '0')
+		digits.pop_back();
+	return digits.empty() ? 1 : (int)digits.size();
+}
+
+// Fewest digits that read back to a double: the number rounded to 1, 2... digits, or
+// the next decimal up or down, as the interval of a power of two is not centered
+static int shortestCount(double value)
+{
+	char number[32];
+	for (int digits = 1; digits < 17; digits++)
+	{
+		snprintf(number, sizeof(number), "%.*e", digits - 1, value);
+		char* e = strchr(number, 'e');
+		unsigned long long significand = 0;
+		for (char* p = number; p < e; p++)
+			if (*p >= '0' && *p <= '9')
+				significand = 10 * significand + (unsigned long long)(*p - '0');
+		int exponent = atoi(e + 1) - (digits - 1);
+		for (unsigned long long candidate = significand - 1; candidate <= significand + 1; candidate++)
+		{
+			snprintf(number, sizeof(number), "%llue%d", candidate, exponent);
+			if (strtod(number, nullptr) == value)
+				return digits;
+		}
+	}
+	return 17;
+}
+
+/** writesBack()
+ * @brief Writes a double and reads it back
+ * @param value Finite number
+ * @return true if the text reads back to the same bits with the fewest digits
+ */
+static bool writesBack(double value)
+{
+	String number = text(json::let(value));
+	bool exact = bits(strtod(number.c_str(), nullptr)) == bits(value);
+	bool shortest = value == 0 || digitCount(number) == shortestCount(std::fabs(value));
+	if (!exact || !shortest)
+		std::cout << "  " << number << (exact ? " is not the shortest" : " does not read back") << std::endl;
+	return exact && shortest;
+}
+
+int main()
+{
+	// Layout: positional from 1e-6 to 1e21, decimals keep a fraction or exponent
+	static const std::pair<double, const char*> layout[] = {
+		{ 0.0, "0.0" }, { -0.0, "-0.0" }, { 1.0, "1.0" }, { -1.5, "-1.5" }, { 0.1, "0.1" }, { 100.0, "100.0" },
+		{ 1e23, "1e+23" }, { 1e21, "1e+21" }, { 1e20, "100000000000000000000.0" }, { 1e-6, "0.000001" },
+		{ 1e-7, "1e-7" }, { 123.456, "123.456" }, { 5e-324, "5e-324" }, { 1.7976931348623157e308, "1.7976931348623157e+308" },
+		{ 2.2250738585072014e-308, "2.2250738585072014e-308" }, { 2.225073858507201e-308, "2.225073858507201e-308" },
+		{ 9007199254740993.0, "9007199254740992.0" }, { 0.30000000000000004, "0.30000000000000004" }, { 5e22, "5e+22" },
+		{ 1.0 / 3, "0.3333333333333333" }, { 2.5e-5, "0.000025" }, { 4.35, "4.35" }, { 9.5e-322, "9.5e-322" },
+	};
+	for (auto& number : layout)
+	{
+		String written = text(json::let(number.first));
+		if (!CHECK(written == number.second))
+			std::cout << "  " << number.second << " written as " << written << std::endl;
+		CHECK(writesBack(number.first));
+	}
+
+	// Infinities and NaN are not JSON
+	CHECK(text(json::let(std::numeric_limits<double>::infinity())) == "null");
+	CHECK(text(json::let(std::numeric_limits<double>::quiet_NaN())) == "null");
+
+	// Floats read back as floats
+	CHECK(text(json::let(0.1f)) == "0.1" && text(json::let(16777216.0f)) == "16777216.0");
+	CHECK(text(json::let(3.4028235e38f)) == "3.4028235e+38" && text(json::let(1e-45f)) == "1e-45");
+
+	// Powers of ten and of two, whose rounding interval is not centered
+	for (int e = -323; e <= 308; e++)
+		CHECK(writesBack(strtod(("1e" + std::to_string(e)).c_str(), nullptr)));
+	for (int e = -1074; e <= 1023; e++)
+		CHECK(writesBack(std::ldexp(1.0, e)));
+
+	// Random doubles, and random subnormals
+	std::mt19937_64 random(20260417);
+	for (int i = 0; i < 100000; i++)
+	{
+		unsigned long long pattern = random();
+		if (i % 4 == 0)
+			pattern &= 0x800FFFFFFFFFFFFFULL;
+		double value;
+		memcpy(&value, &pattern, sizeof(value));
+		if (value != value || value - value != 0)
+			continue;
+		if (!CHECK(writesBack(value)))
+			break;
+	}
+	return checkResult("writer");
+}